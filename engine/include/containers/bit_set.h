@@ -0,0 +1,122 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+
+#include <bit>
+
+#if defined(Q_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace gravity {
+namespace containers {
+
+/// @brief Fixed size set of BITS bits packed into 64-bit words.
+/// Whole-set operations work on 128 bits at a time with SSE2 where available,
+/// so combining two sets of a few hundred bits is a handful of instructions.
+/// Bits past BITS are always zero.
+template <usize BITS>
+class BitSet {
+public:
+    static constexpr usize WORD_BITS = 64;
+    static constexpr usize WORDS = (BITS + WORD_BITS - 1) / WORD_BITS;
+
+    bool test(usize bit) const { return (_words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1; }
+    void set(usize bit) { _words[bit / WORD_BITS] |= u64(1) << (bit % WORD_BITS); }
+    void reset(usize bit) { _words[bit / WORD_BITS] &= ~(u64(1) << (bit % WORD_BITS)); }
+    void set(usize bit, bool value) {
+        u64 mask = u64(1) << (bit % WORD_BITS);
+        u64& word = _words[bit / WORD_BITS];
+        word = value ? word | mask : word & ~mask;
+    }
+    bool operator[](usize bit) const { return test(bit); }
+
+    /// @brief Clear every bit
+    void clear() {
+        for (usize i = 0; i < WORDS; i++) {
+            _words[i] = 0;
+        }
+    }
+
+    bool any() const {
+        u64 bits = 0;
+        for (usize i = 0; i < WORDS; i++) {
+            bits |= _words[i];
+        }
+        return bits != 0;
+    }
+    bool none() const { return !any(); }
+
+    /// @brief Number of set bits
+    usize count() const {
+        usize total = 0;
+        for (usize i = 0; i < WORDS; i++) {
+            total += static_cast<usize>(std::popcount(_words[i]));
+        }
+        return total;
+    }
+
+    /// @brief Call `fn(bit)` for each set bit in ascending order
+    template <typename FN>
+    void for_each(FN&& fn) const {
+        for (usize i = 0; i < WORDS; i++) {
+            for (u64 word = _words[i]; word; word &= word - 1) {
+                fn(i * WORD_BITS + static_cast<usize>(std::countr_zero(word)));
+            }
+        }
+    }
+
+    BitSet operator&(const BitSet& other) const { return _combine<AND>(*this, other); }
+    BitSet operator|(const BitSet& other) const { return _combine<OR>(*this, other); }
+    BitSet operator^(const BitSet& other) const { return _combine<XOR>(*this, other); }
+
+    /// @brief Bits set in `a` but not in `b`
+    static BitSet and_not(const BitSet& a, const BitSet& b) { return _combine<AND_NOT>(a, b); }
+
+    bool operator==(const BitSet& other) const {
+        for (usize i = 0; i < WORDS; i++) {
+            if (_words[i] != other._words[i]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const BitSet& other) const { return !(*this == other); }
+
+    const u64* words() const { return _words; }
+private:
+    enum Op { AND, OR, XOR, AND_NOT };
+
+    template <Op OP>
+    static u64 _apply(u64 a, u64 b) {
+        if constexpr (OP == AND) return a & b;
+        else if constexpr (OP == OR) return a | b;
+        else if constexpr (OP == XOR) return a ^ b;
+        else return a & ~b;
+    }
+
+    template <Op OP>
+    static BitSet _combine(const BitSet& a, const BitSet& b) {
+        BitSet result;
+        usize i = 0;
+#if defined(Q_SSE2)
+        for (; i + 2 <= WORDS; i += 2) {
+            __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(a._words + i));
+            __m128i y = _mm_load_si128(reinterpret_cast<const __m128i*>(b._words + i));
+            __m128i r;
+            if constexpr (OP == AND) r = _mm_and_si128(x, y);
+            else if constexpr (OP == OR) r = _mm_or_si128(x, y);
+            else if constexpr (OP == XOR) r = _mm_xor_si128(x, y);
+            else r = _mm_andnot_si128(y, x);
+            _mm_store_si128(reinterpret_cast<__m128i*>(result._words + i), r);
+        }
+#endif
+        for (; i < WORDS; i++) {
+            result._words[i] = _apply<OP>(a._words[i], b._words[i]);
+        }
+        return result;
+    }
+
+    alignas(16) u64 _words[WORDS] {};
+};
+
+} // containers namespace
+} // gravity namespace
@@ -0,0 +1,529 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gravity {
+namespace containers {
+
+/// @brief Ordered map stored as a B+tree with wide nodes.
+/// Each node packs dozens of keys into a few cache lines, so a lookup
+/// touches a handful of nodes instead of one per level of a binary tree, and
+/// elements live only in the leaves, which are linked for in-order and range
+/// iteration. Nodes are split when full and, when an erase leaves them mostly
+/// empty, merged with or refilled from a neighbour.
+/// Keys and values must be default constructible and move assignable. Elements
+/// move within and between nodes, so iterators and references are invalidated
+/// by insert and erase. Nodes come from memory::allocate under a tag (BST by default).
+template <typename K, typename V, typename LESS = std::less<K>>
+class BTree {
+    // Target node size; large enough to amortise a cache miss over many keys
+    static constexpr usize NODE_BYTES = 512;
+public:
+    static constexpr u32 LEAF_CAPACITY = static_cast<u32>(std::clamp<usize>(NODE_BYTES / (sizeof(K) + sizeof(V)), 4, 255));
+    static constexpr u32 INNER_CAPACITY = static_cast<u32>(std::clamp<usize>(NODE_BYTES / (sizeof(K) + sizeof(void*)), 4, 255));
+private:
+    // Nodes below these counts are merged with or refilled from a neighbour
+    static constexpr u32 LEAF_MIN = LEAF_CAPACITY / 3;
+    static constexpr u32 INNER_MIN = INNER_CAPACITY / 3;
+    static constexpr u32 MAX_DEPTH = 32;
+
+    struct Node {
+        u16 count;   // keys in the node
+        bool leaf;
+    };
+
+    struct Leaf : Node {
+        Leaf() : Node { 0, true } {}
+
+        K keys[LEAF_CAPACITY];
+        V values[LEAF_CAPACITY];
+        Leaf* prev { nullptr };
+        Leaf* next { nullptr };
+    };
+
+    /// @brief keys[i] is the smallest key under children[i + 1]
+    struct Inner : Node {
+        Inner() : Node { 0, false } {}
+
+        K keys[INNER_CAPACITY];
+        Node* children[INNER_CAPACITY + 1];
+    };
+
+    /// @brief An inner node on the way down and the child taken from it
+    struct PathEntry {
+        Inner* node;
+        u32 index;
+    };
+public:
+    template <bool CONST>
+    class Iterator {
+    public:
+        using value_reference = std::conditional_t<CONST, const V&, V&>;
+
+        Iterator() = default;
+        Iterator(Leaf* leaf, u32 index) : _leaf(leaf), _index(index) {}
+        template <bool OTHER> requires (CONST && !OTHER)
+        Iterator(const Iterator<OTHER>& other) : _leaf(other._leaf), _index(other._index) {}
+
+        const K& key() const { return _leaf->keys[_index]; }
+        value_reference value() const { return _leaf->values[_index]; }
+        std::pair<const K&, value_reference> operator*() const { return { key(), value() }; }
+
+        Iterator& operator++() {
+            if (++_index == _leaf->count) {
+                _leaf = _leaf->next;
+                _index = 0;
+            }
+            return *this;
+        }
+        Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+        bool operator==(const Iterator& other) const { return _leaf == other._leaf && _index == other._index; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    private:
+        friend class BTree;
+        template <bool> friend class Iterator;
+
+        Leaf* _leaf { nullptr };   // nullptr at the end
+        u32 _index { 0 };
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// @brief Pair of iterators usable in a range-for
+    template <typename IT>
+    struct Range {
+        IT first;
+        IT last;
+
+        IT begin() const { return first; }
+        IT end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+
+    explicit BTree(memory::tag memory_tag = memory::tag::BST) : _tag(memory_tag) {}
+
+    BTree(BTree&& other) noexcept { _take(other); }
+    BTree& operator=(BTree&& other) noexcept {
+        if (this != &other) {
+            clear();
+            _take(other);
+        }
+        return *this;
+    }
+
+    ~BTree() { clear(); }
+
+    usize size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    iterator begin() { return iterator(_first, 0); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(_first, 0); }
+    const_iterator end() const { return const_iterator(); }
+
+    iterator find(const K& key) { return _find(key); }
+    const_iterator find(const K& key) const { return _find(key); }
+    bool contains(const K& key) const { return _find(key) != end(); }
+
+    /// @brief First element whose key is not less than `key`
+    iterator lower_bound(const K& key) { return _bound<false>(key); }
+    const_iterator lower_bound(const K& key) const { return _bound<false>(key); }
+
+    /// @brief First element whose key is greater than `key`
+    iterator upper_bound(const K& key) { return _bound<true>(key); }
+    const_iterator upper_bound(const K& key) const { return _bound<true>(key); }
+
+    /// @brief Elements with keys in [first, last)
+    Range<iterator> range(const K& first, const K& last) { return { lower_bound(first), lower_bound(last) }; }
+    Range<const_iterator> range(const K& first, const K& last) const { return { lower_bound(first), lower_bound(last) }; }
+
+    /// @brief Insert `key` with a value built from `args` unless it is already present
+    /// @return Iterator to the element for `key` and whether it was inserted
+    template <typename KEY, typename... ARGS>
+    std::pair<iterator, bool> try_emplace(KEY&& key, ARGS&&... args) {
+        if (!_root) {
+            _first = _last = _new_leaf();
+            _root = _first;
+        }
+
+        PathEntry path[MAX_DEPTH];
+        u32 depth = 0;
+        Leaf* leaf = _descend(key, path, depth);
+        u32 pos = _lower_bound(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && !LESS{}(key, leaf->keys[pos])) {
+            return { iterator(leaf, pos), false };
+        }
+
+        if (leaf->count == LEAF_CAPACITY) {
+            Leaf* right = _split_leaf(leaf);
+            _insert_into_parent(path, depth, leaf, K(right->keys[0]), right);
+            if (pos > leaf->count) {
+                pos -= leaf->count;
+                leaf = right;
+            }
+        }
+
+        std::move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+        std::move_backward(leaf->values + pos, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+        leaf->keys[pos] = K(std::forward<KEY>(key));
+        leaf->values[pos] = V(std::forward<ARGS>(args)...);
+        leaf->count++;
+        _size++;
+        return { iterator(leaf, pos), true };
+    }
+
+    /// @brief Insert `key`, or overwrite its value if it is already present
+    template <typename KEY, typename VALUE>
+    std::pair<iterator, bool> insert_or_assign(KEY&& key, VALUE&& value) {
+        auto result = try_emplace(std::forward<KEY>(key), std::forward<VALUE>(value));
+        if (!result.second) {
+            result.first.value() = std::forward<VALUE>(value);
+        }
+        return result;
+    }
+
+    V& operator[](const K& key) { return try_emplace(key).first.value(); }
+
+    /// @brief Remove the element for `key`
+    /// @return Number of elements removed
+    usize erase(const K& key) {
+        if (!_root) {
+            return 0;
+        }
+
+        PathEntry path[MAX_DEPTH];
+        u32 depth = 0;
+        Leaf* leaf = _descend(key, path, depth);
+        u32 pos = _lower_bound(leaf->keys, leaf->count, key);
+        if (pos == leaf->count || LESS{}(key, leaf->keys[pos])) {
+            return 0;
+        }
+
+        std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+        std::move(leaf->values + pos + 1, leaf->values + leaf->count, leaf->values + pos);
+        leaf->count--;
+        _size--;
+        _rebalance_leaf(leaf, path, depth);
+        return 1;
+    }
+
+    /// @brief Remove every element and free every node
+    void clear() {
+        if (_root) {
+            _free_subtree(_root);
+        }
+        _root = nullptr;
+        _first = _last = nullptr;
+        _size = 0;
+    }
+private:
+    template <typename KEY>
+    static u32 _lower_bound(const K* keys, u32 count, const KEY& key) {
+        return static_cast<u32>(std::lower_bound(keys, keys + count, key, LESS{}) - keys);
+    }
+    template <typename KEY>
+    static u32 _upper_bound(const K* keys, u32 count, const KEY& key) {
+        return static_cast<u32>(std::upper_bound(keys, keys + count, key, LESS{}) - keys);
+    }
+
+    /// @brief Walk down to the leaf that holds or would hold `key`, recording the inner nodes passed
+    template <typename KEY>
+    Leaf* _descend(const KEY& key, PathEntry* path, u32& depth) const {
+        Node* node = _root;
+        while (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            u32 index = _upper_bound(inner->keys, inner->count, key);
+            path[depth++] = { inner, index };
+            node = inner->children[index];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    iterator _find(const K& key) const {
+        if (!_root) {
+            return iterator();
+        }
+        PathEntry path[MAX_DEPTH];
+        u32 depth = 0;
+        Leaf* leaf = _descend(key, path, depth);
+        u32 pos = _lower_bound(leaf->keys, leaf->count, key);
+        return pos < leaf->count && !LESS{}(key, leaf->keys[pos]) ? iterator(leaf, pos) : iterator();
+    }
+
+    template <bool UPPER>
+    iterator _bound(const K& key) const {
+        if (!_root) {
+            return iterator();
+        }
+        PathEntry path[MAX_DEPTH];
+        u32 depth = 0;
+        Leaf* leaf = _descend(key, path, depth);
+        u32 pos = UPPER ? _upper_bound(leaf->keys, leaf->count, key) : _lower_bound(leaf->keys, leaf->count, key);
+        if (pos == leaf->count) {
+            return iterator(leaf->next, 0);
+        }
+        return iterator(leaf, pos);
+    }
+
+    Leaf* _new_leaf() {
+        void* memory = memory::allocate(sizeof(Leaf), alignof(Leaf), _tag);
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        return new (memory) Leaf();
+    }
+
+    Inner* _new_inner() {
+        void* memory = memory::allocate(sizeof(Inner), alignof(Inner), _tag);
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        return new (memory) Inner();
+    }
+
+    void _free_node(Node* node) {
+        if (node->leaf) {
+            static_cast<Leaf*>(node)->~Leaf();
+            memory::free(node, sizeof(Leaf), alignof(Leaf), _tag);
+        } else {
+            static_cast<Inner*>(node)->~Inner();
+            memory::free(node, sizeof(Inner), alignof(Inner), _tag);
+        }
+    }
+
+    void _free_subtree(Node* node) {
+        if (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            for (u32 i = 0; i <= inner->count; i++) {
+                _free_subtree(inner->children[i]);
+            }
+        }
+        _free_node(node);
+    }
+
+    /// @brief Move the upper half of a full leaf into a new leaf linked after it
+    Leaf* _split_leaf(Leaf* leaf) {
+        Leaf* right = _new_leaf();
+        u32 mid = leaf->count / 2;
+        std::move(leaf->keys + mid, leaf->keys + leaf->count, right->keys);
+        std::move(leaf->values + mid, leaf->values + leaf->count, right->values);
+        right->count = static_cast<u16>(leaf->count - mid);
+        leaf->count = static_cast<u16>(mid);
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next) {
+            leaf->next->prev = right;
+        } else {
+            _last = right;
+        }
+        leaf->next = right;
+        return right;
+    }
+
+    /// @brief Put `key` and the child after it into an inner node that has room
+    static void _inner_insert(Inner* node, u32 index, K&& key, Node* right) {
+        std::move_backward(node->keys + index, node->keys + node->count, node->keys + node->count + 1);
+        std::move_backward(node->children + index + 1, node->children + node->count + 1, node->children + node->count + 2);
+        node->keys[index] = std::move(key);
+        node->children[index + 1] = right;
+        node->count++;
+    }
+
+    /// @brief Remove keys[index] and children[index + 1] from an inner node
+    static void _inner_remove(Inner* node, u32 index) {
+        std::move(node->keys + index + 1, node->keys + node->count, node->keys + index);
+        std::move(node->children + index + 2, node->children + node->count + 1, node->children + index + 1);
+        node->count--;
+    }
+
+    /// @brief Link `right`, split off from `left`, into the tree above it, splitting full inner nodes on the way up
+    /// @param path Inner nodes from the root down to the parent of `left`
+    /// @param depth Number of entries in `path`
+    /// @param key Smallest key under `right`
+    void _insert_into_parent(PathEntry* path, u32 depth, Node* left, K&& key, Node* right) {
+        while (depth > 0) {
+            auto [parent, index] = path[--depth];
+            if (parent->count < INNER_CAPACITY) {
+                _inner_insert(parent, index, std::move(key), right);
+                return;
+            }
+
+            // Split the parent around its middle key, which moves up a level
+            Inner* sibling = _new_inner();
+            u32 mid = parent->count / 2;
+            K up = std::move(parent->keys[mid]);
+            sibling->count = static_cast<u16>(parent->count - mid - 1);
+            std::move(parent->keys + mid + 1, parent->keys + parent->count, sibling->keys);
+            std::move(parent->children + mid + 1, parent->children + parent->count + 1, sibling->children);
+            parent->count = static_cast<u16>(mid);
+
+            if (index <= mid) {
+                _inner_insert(parent, index, std::move(key), right);
+            } else {
+                _inner_insert(sibling, index - mid - 1, std::move(key), right);
+            }
+
+            left = parent;
+            key = std::move(up);
+            right = sibling;
+        }
+
+        Inner* root = _new_inner();
+        root->keys[0] = std::move(key);
+        root->children[0] = left;
+        root->children[1] = right;
+        root->count = 1;
+        _root = root;
+    }
+
+    /// @brief Merge a leaf that has become sparse with a neighbour, or borrow from it if the two do not fit in one
+    void _rebalance_leaf(Leaf* leaf, PathEntry* path, u32 depth) {
+        if (depth == 0) {
+            if (leaf->count == 0) {
+                _free_node(leaf);
+                _root = nullptr;
+                _first = _last = nullptr;
+            }
+            return;
+        }
+        if (leaf->count >= LEAF_MIN) {
+            return;
+        }
+
+        auto [parent, index] = path[depth - 1];
+        Leaf* left = nullptr;
+        Leaf* right = nullptr;
+        if (index < parent->count) {
+            left = leaf;
+            right = static_cast<Leaf*>(parent->children[index + 1]);
+        } else {
+            left = static_cast<Leaf*>(parent->children[index - 1]);
+            right = leaf;
+            index--;
+        }
+        if (static_cast<u32>(left->count) + right->count > LEAF_CAPACITY) {
+            // The neighbour is nearly full: borrow one element from it instead
+            if (leaf == left) {
+                left->keys[left->count] = std::move(right->keys[0]);
+                left->values[left->count] = std::move(right->values[0]);
+                left->count++;
+                std::move(right->keys + 1, right->keys + right->count, right->keys);
+                std::move(right->values + 1, right->values + right->count, right->values);
+                right->count--;
+            } else {
+                std::move_backward(right->keys, right->keys + right->count, right->keys + right->count + 1);
+                std::move_backward(right->values, right->values + right->count, right->values + right->count + 1);
+                right->keys[0] = std::move(left->keys[left->count - 1]);
+                right->values[0] = std::move(left->values[left->count - 1]);
+                right->count++;
+                left->count--;
+            }
+            parent->keys[index] = right->keys[0];
+            return;
+        }
+
+        std::move(right->keys, right->keys + right->count, left->keys + left->count);
+        std::move(right->values, right->values + right->count, left->values + left->count);
+        left->count = static_cast<u16>(left->count + right->count);
+        left->next = right->next;
+        if (right->next) {
+            right->next->prev = left;
+        } else {
+            _last = left;
+        }
+        _free_node(right);
+        _inner_remove(parent, index);
+        _rebalance_inner(path, depth - 1);
+    }
+
+    /// @brief Merge or refill sparse inner nodes up the path, and drop a root left with a single child
+    /// @param level Index in `path` of the node whose child count just dropped
+    void _rebalance_inner(PathEntry* path, u32 level) {
+        for (;;) {
+            Inner* node = path[level].node;
+            if (level == 0) {
+                if (node->count == 0) {
+                    _root = node->children[0];
+                    _free_node(node);
+                }
+                return;
+            }
+            if (node->count >= INNER_MIN) {
+                return;
+            }
+
+            auto [parent, index] = path[level - 1];
+            Inner* left = nullptr;
+            Inner* right = nullptr;
+            if (index < parent->count) {
+                left = node;
+                right = static_cast<Inner*>(parent->children[index + 1]);
+            } else {
+                left = static_cast<Inner*>(parent->children[index - 1]);
+                right = node;
+                index--;
+            }
+            if (static_cast<u32>(left->count) + 1 + right->count > INNER_CAPACITY) {
+                // The neighbour is nearly full: rotate one child through the parent instead
+                if (node == left) {
+                    left->keys[left->count] = std::move(parent->keys[index]);
+                    left->children[left->count + 1] = right->children[0];
+                    left->count++;
+                    parent->keys[index] = std::move(right->keys[0]);
+                    std::move(right->keys + 1, right->keys + right->count, right->keys);
+                    std::move(right->children + 1, right->children + right->count + 1, right->children);
+                    right->count--;
+                } else {
+                    std::move_backward(right->keys, right->keys + right->count, right->keys + right->count + 1);
+                    std::move_backward(right->children, right->children + right->count + 1, right->children + right->count + 2);
+                    right->keys[0] = std::move(parent->keys[index]);
+                    right->children[0] = left->children[left->count];
+                    right->count++;
+                    parent->keys[index] = std::move(left->keys[left->count - 1]);
+                    left->count--;
+                }
+                return;
+            }
+
+            // The separator comes down between the two halves
+            left->keys[left->count] = std::move(parent->keys[index]);
+            std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+            std::move(right->children, right->children + right->count + 1, left->children + left->count + 1);
+            left->count = static_cast<u16>(left->count + 1 + right->count);
+            _free_node(right);
+            _inner_remove(parent, index);
+            level--;
+        }
+    }
+
+    void _take(BTree& other) {
+        _root = other._root;
+        _first = other._first;
+        _last = other._last;
+        _size = other._size;
+        _tag = other._tag;
+        other._root = nullptr;
+        other._first = other._last = nullptr;
+        other._size = 0;
+    }
+
+    Node* _root { nullptr };
+    Leaf* _first { nullptr };   // leftmost leaf, where iteration starts
+    Leaf* _last { nullptr };    // rightmost leaf
+    usize _size { 0 };
+    memory::tag _tag { memory::tag::BST };
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+};
+
+} // containers namespace
+} // gravity namespace
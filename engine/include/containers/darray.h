@@ -0,0 +1,349 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gravity {
+namespace containers {
+
+/// @brief Whether a T can be moved to a new address with memcpy, leaving
+/// nothing to destroy at the old one. True for trivially copyable types;
+/// specialise it for types that only hold pointers to other memory.
+template <typename T>
+struct TriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+struct TriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
+/// @brief Default DArray allocator: memory::allocate() accounted to a tag
+struct TaggedAllocator {
+    memory::tag memory_tag;
+
+    TaggedAllocator(memory::tag memory_tag = memory::tag::DARRAY) : memory_tag(memory_tag) {}
+
+    void* allocate(usize size, usize alignment) { return memory::allocate(size, alignment, memory_tag); }
+    void free(void* block, usize size, usize alignment) { memory::free(block, size, alignment, memory_tag); }
+};
+
+/// @brief DArray allocator that takes memory from a StackAllocator. Blocks are
+/// never freed individually; they go away when the stack is popped, so the
+/// array must not outlive the StackScope it was filled in.
+struct ScratchAllocator {
+    memory::StackAllocator* stack;
+
+    ScratchAllocator(memory::StackAllocator& stack = memory::MemorySystem::thread_stack()) : stack(&stack) {}
+
+    void* allocate(usize size, usize alignment) { return stack->allocate(size, alignment); }
+    void free(void*, usize, usize) {}
+};
+
+/// @brief Storage for the first INLINE elements of a DArray
+template <typename T, usize INLINE>
+struct DArrayInline {
+    alignas(T) u8 bytes[INLINE * sizeof(T)];
+};
+
+template <typename T>
+struct DArrayInline<T, 0> {};
+
+/// @brief Dynamic array with room for INLINE elements inside the object itself.
+/// Short lists never touch the heap; longer ones spill into memory from
+/// ALLOCATOR, which is anything with allocate(size, alignment) and
+/// free(block, size, alignment) (TaggedAllocator, accounting to DARRAY, by
+/// default). Elements of trivially relocatable types are moved with memcpy
+/// when the array grows. Iterators are plain pointers and are invalidated by
+/// any insertion that grows the array, and by moving an array that still
+/// fits in its inline storage.
+template <typename T, usize INLINE = 0, typename ALLOCATOR = TaggedAllocator>
+class DArray {
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    explicit DArray(ALLOCATOR allocator = ALLOCATOR())
+        : _data(_inline_data())
+        , _capacity(INLINE)
+        , _allocator(allocator)
+        {}
+
+    DArray(std::initializer_list<T> values, ALLOCATOR allocator = ALLOCATOR()) : DArray(allocator) {
+        reserve(values.size());
+        for (const T& value : values) {
+            new (_data + _size++) T(value);
+        }
+    }
+
+    DArray(const DArray& other) : DArray(other._allocator) {
+        reserve(other._size);
+        _copy_construct(_data, other._data, other._size);
+        _size = other._size;
+    }
+
+    DArray(DArray&& other) noexcept : DArray(other._allocator) { _take(other); }
+
+    DArray& operator=(const DArray& other) {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            _copy_construct(_data, other._data, other._size);
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    DArray& operator=(DArray&& other) noexcept {
+        if (this != &other) {
+            _destroy();
+            _allocator = other._allocator;
+            _take(other);
+        }
+        return *this;
+    }
+
+    ~DArray() { _destroy(); }
+
+    usize size() const { return _size; }
+    usize capacity() const { return _capacity; }
+    bool empty() const { return _size == 0; }
+    /// @brief Whether the elements live in the inline storage
+    bool is_inline() const { return _data == _inline_data(); }
+
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
+    T& operator[](usize index) { return _data[index]; }
+    const T& operator[](usize index) const { return _data[index]; }
+    T& front() { return _data[0]; }
+    const T& front() const { return _data[0]; }
+    T& back() { return _data[_size - 1]; }
+    const T& back() const { return _data[_size - 1]; }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    /// @brief Construct an element at the end. `args` may refer to an element of the array
+    template <typename... ARGS>
+    T& emplace_back(ARGS&&... args) {
+        if (_size == _capacity) {
+            return _grow_emplace_back(std::forward<ARGS>(args)...);
+        }
+        T* element = new (_data + _size) T(std::forward<ARGS>(args)...);
+        _size++;
+        return *element;
+    }
+
+    void pop_back() {
+        _size--;
+        _data[_size].~T();
+    }
+
+    /// @brief Insert an element before `position`
+    /// @return Iterator to the inserted element
+    iterator insert(const_iterator position, T value) {
+        usize index = static_cast<usize>(position - _data);
+        if (index == _size) {
+            emplace_back(std::move(value));
+            return _data + index;
+        }
+
+        emplace_back(std::move(_data[_size - 1]));
+        std::move_backward(_data + index, _data + _size - 2, _data + _size - 1);
+        _data[index] = std::move(value);
+        return _data + index;
+    }
+
+    /// @brief Remove the element at `position`, keeping the order of the rest
+    /// @return Iterator to the element after the removed one
+    iterator erase(const_iterator position) { return erase(position, position + 1); }
+
+    /// @brief Remove the elements in [first, last), keeping the order of the rest
+    /// @return Iterator to the element after the removed ones
+    iterator erase(const_iterator first, const_iterator last) {
+        T* begin = _data + (first - _data);
+        T* end = _data + (last - _data);
+        if (begin != end) {
+            T* new_end = std::move(end, _data + _size, begin);
+            std::destroy(new_end, _data + _size);
+            _size = static_cast<usize>(new_end - _data);
+        }
+        return begin;
+    }
+
+    /// @brief Remove the element at `index` by moving the last element into its place
+    void swap_erase(usize index) {
+        if (index != _size - 1) {
+            _data[index] = std::move(_data[_size - 1]);
+        }
+        pop_back();
+    }
+
+    /// @brief Destroy every element, keeping the storage
+    void clear() {
+        std::destroy(_data, _data + _size);
+        _size = 0;
+    }
+
+    /// @brief Make room for `count` elements without growing
+    void reserve(usize count) {
+        if (count > _capacity) {
+            _reallocate(count);
+        }
+    }
+
+    /// @brief Grow or shrink to `count` elements, value-initialising new ones
+    void resize(usize count) {
+        if (count < _size) {
+            std::destroy(_data + count, _data + _size);
+        } else {
+            reserve(count);
+            std::uninitialized_value_construct(_data + _size, _data + count);
+        }
+        _size = count;
+    }
+
+    /// @brief Grow or shrink to `count` elements, copying `value` into new ones
+    void resize(usize count, const T& value) {
+        if (count < _size) {
+            std::destroy(_data + count, _data + _size);
+        } else {
+            reserve(count);
+            std::uninitialized_fill(_data + _size, _data + count, value);
+        }
+        _size = count;
+    }
+
+    /// @brief Release unused heap capacity, moving back inline if the elements fit
+    void shrink_to_fit() {
+        if (!is_inline() && _size < _capacity) {
+            _reallocate(_size);
+        }
+    }
+private:
+    static constexpr bool RELOCATABLE = TriviallyRelocatable<T>::value;
+    static constexpr usize ALIGNMENT = std::max<usize>(alignof(T), alignof(std::max_align_t));
+    // Smallest heap capacity, so short arrays without inline storage do not grow one element at a time
+    static constexpr usize MIN_CAPACITY = std::max<usize>(4, INLINE * 2);
+
+    T* _inline_data() const {
+        if constexpr (INLINE > 0) {
+            return reinterpret_cast<T*>(const_cast<u8*>(_inline.bytes));
+        } else {
+            return nullptr;
+        }
+    }
+
+    /// @brief Move `count` elements to uninitialised memory and end the lifetime of the originals
+    static void _relocate(T* dst, T* src, usize count) {
+        if constexpr (RELOCATABLE) {
+            if (count) {
+                std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+            }
+        } else {
+            for (usize i = 0; i < count; i++) {
+                new (dst + i) T(std::move_if_noexcept(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    static void _copy_construct(T* dst, const T* src, usize count) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (count) {
+                std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(T));
+            }
+        } else {
+            std::uninitialized_copy(src, src + count, dst);
+        }
+    }
+
+    T* _allocate(usize capacity) {
+        if (capacity <= INLINE) {
+            return _inline_data();
+        }
+        T* block = static_cast<T*>(_allocator.allocate(capacity * sizeof(T), ALIGNMENT));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+
+    void _free_storage() {
+        if (!is_inline()) {
+            _allocator.free(_data, _capacity * sizeof(T), ALIGNMENT);
+        }
+    }
+
+    usize _grown_capacity(usize required) const {
+        return std::max({ required, _capacity * 2, MIN_CAPACITY });
+    }
+
+    /// @brief Move the elements to storage for `capacity` elements
+    void _reallocate(usize capacity) {
+        T* data = _allocate(capacity);
+        if (data == _data) return;
+        _relocate(data, _data, _size);
+        _free_storage();
+        _data = data;
+        _capacity = std::max(capacity, INLINE);
+    }
+
+    /// @brief Append when full. The new element is built before the old ones
+    /// move, so `args` may refer to an element of the array
+    template <typename... ARGS>
+    T& _grow_emplace_back(ARGS&&... args) {
+        usize capacity = _grown_capacity(_size + 1);
+        T* data = _allocate(capacity);
+        T* element = new (data + _size) T(std::forward<ARGS>(args)...);
+        _relocate(data, _data, _size);
+        _free_storage();
+        _data = data;
+        _capacity = capacity;
+        _size++;
+        return *element;
+    }
+
+    void _destroy() {
+        std::destroy(_data, _data + _size);
+        _free_storage();
+        _data = _inline_data();
+        _size = 0;
+        _capacity = INLINE;
+    }
+
+    /// @brief Take the elements of `other`, which is left empty. Heap storage
+    /// changes hands; inline elements are relocated one by one
+    void _take(DArray& other) {
+        if (other.is_inline()) {
+            _relocate(_data, other._data, other._size);
+        } else {
+            _data = other._data;
+            _capacity = other._capacity;
+            other._data = other._inline_data();
+            other._capacity = INLINE;
+        }
+        _size = other._size;
+        other._size = 0;
+    }
+
+    T* _data;
+    usize _size { 0 };
+    usize _capacity;                     // INLINE while the elements are inline
+    ALLOCATOR _allocator;
+    DArrayInline<T, INLINE> _inline;
+};
+
+} // containers namespace
+} // gravity namespace
@@ -0,0 +1,184 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+#include "containers/darray.h"
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace gravity {
+namespace containers {
+
+/// @brief Ordered map kept as two sorted arrays, one of keys and one of values.
+/// Lookups binary search the packed keys without touching the values, and
+/// iteration is a linear walk, so it beats node based maps for data that is
+/// read far more often than it is changed (registries, sorted render keys).
+/// Inserting or erasing shifts everything after the position, so prefer
+/// BTree for large, frequently modified maps. Iterators and references are
+/// invalidated by insert and erase. Memory comes from memory::allocate under a tag (BST by default).
+template <typename K, typename V, typename LESS = std::less<K>>
+class FlatMap {
+public:
+    template <bool CONST>
+    class Iterator {
+    public:
+        using value_reference = std::conditional_t<CONST, const V&, V&>;
+        using value_pointer = std::conditional_t<CONST, const V*, V*>;
+
+        Iterator() = default;
+        Iterator(const K* key, value_pointer value) : _key(key), _value(value) {}
+        template <bool OTHER> requires (CONST && !OTHER)
+        Iterator(const Iterator<OTHER>& other) : _key(other._key), _value(other._value) {}
+
+        const K& key() const { return *_key; }
+        value_reference value() const { return *_value; }
+        std::pair<const K&, value_reference> operator*() const { return { *_key, *_value }; }
+
+        Iterator& operator++() { _key++; _value++; return *this; }
+        Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+        Iterator& operator--() { _key--; _value--; return *this; }
+        bool operator==(const Iterator& other) const { return _key == other._key; }
+        bool operator!=(const Iterator& other) const { return _key != other._key; }
+    private:
+        friend class FlatMap;
+        template <bool> friend class Iterator;
+
+        const K* _key { nullptr };
+        value_pointer _value { nullptr };
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// @brief Pair of iterators usable in a range-for
+    template <typename IT>
+    struct Range {
+        IT first;
+        IT last;
+
+        IT begin() const { return first; }
+        IT end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+
+    explicit FlatMap(memory::tag memory_tag = memory::tag::BST)
+        : _keys(memory_tag)
+        , _values(memory_tag)
+        {}
+
+    usize size() const { return _keys.size(); }
+    bool empty() const { return _keys.empty(); }
+
+    iterator begin() { return _at(0); }
+    iterator end() { return _at(size()); }
+    const_iterator begin() const { return _at(0); }
+    const_iterator end() const { return _at(size()); }
+
+    /// @brief The sorted keys, e.g. for a vectorised scan
+    const K* keys() const { return _keys.data(); }
+
+    iterator find(const K& key) {
+        usize index = _lower_bound(key);
+        return index < size() && !LESS{}(key, _keys[index]) ? _at(index) : end();
+    }
+    const_iterator find(const K& key) const {
+        usize index = _lower_bound(key);
+        return index < size() && !LESS{}(key, _keys[index]) ? _at(index) : end();
+    }
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    /// @brief First element whose key is not less than `key`
+    iterator lower_bound(const K& key) { return _at(_lower_bound(key)); }
+    const_iterator lower_bound(const K& key) const { return _at(_lower_bound(key)); }
+
+    /// @brief First element whose key is greater than `key`
+    iterator upper_bound(const K& key) { return _at(_upper_bound(key)); }
+    const_iterator upper_bound(const K& key) const { return _at(_upper_bound(key)); }
+
+    /// @brief Elements with keys in [first, last)
+    Range<iterator> range(const K& first, const K& last) { return { lower_bound(first), lower_bound(last) }; }
+    Range<const_iterator> range(const K& first, const K& last) const { return { lower_bound(first), lower_bound(last) }; }
+
+    /// @brief Insert `key` with a value built from `args` unless it is already present
+    /// @return Iterator to the element for `key` and whether it was inserted
+    template <typename KEY, typename... ARGS>
+    std::pair<iterator, bool> try_emplace(KEY&& key, ARGS&&... args) {
+        usize index = _lower_bound(key);
+        if (index < size() && !LESS{}(key, _keys[index])) {
+            return { _at(index), false };
+        }
+        _keys.insert(_keys.begin() + index, K(std::forward<KEY>(key)));
+        _values.insert(_values.begin() + index, V(std::forward<ARGS>(args)...));
+        return { _at(index), true };
+    }
+
+    /// @brief Insert `key`, or overwrite its value if it is already present
+    template <typename KEY, typename VALUE>
+    std::pair<iterator, bool> insert_or_assign(KEY&& key, VALUE&& value) {
+        auto result = try_emplace(std::forward<KEY>(key), std::forward<VALUE>(value));
+        if (!result.second) {
+            _values[result.first._key - _keys.data()] = std::forward<VALUE>(value);
+        }
+        return result;
+    }
+
+    V& operator[](const K& key) { return try_emplace(key).first.value(); }
+
+    /// @brief Remove the element for `key`
+    /// @return Number of elements removed
+    usize erase(const K& key) {
+        iterator it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    /// @brief Remove the element at `it`
+    /// @return Iterator to the next element
+    iterator erase(const_iterator it) {
+        usize index = static_cast<usize>(it._key - _keys.data());
+        _keys.erase(_keys.begin() + index);
+        _values.erase(_values.begin() + index);
+        return _at(index);
+    }
+
+    /// @brief Remove the elements with keys in [first, last)
+    /// @return Number of elements removed
+    usize erase_range(const K& first, const K& last) {
+        usize begin = _lower_bound(first);
+        usize end = std::max(begin, _lower_bound(last));
+        _keys.erase(_keys.begin() + begin, _keys.begin() + end);
+        _values.erase(_values.begin() + begin, _values.begin() + end);
+        return end - begin;
+    }
+
+    void clear() {
+        _keys.clear();
+        _values.clear();
+    }
+
+    void reserve(usize count) {
+        _keys.reserve(count);
+        _values.reserve(count);
+    }
+private:
+    iterator _at(usize index) { return iterator(_keys.data() + index, _values.data() + index); }
+    const_iterator _at(usize index) const { return const_iterator(_keys.data() + index, _values.data() + index); }
+
+    usize _lower_bound(const K& key) const {
+        return static_cast<usize>(std::lower_bound(_keys.begin(), _keys.end(), key, LESS{}) - _keys.begin());
+    }
+    usize _upper_bound(const K& key) const {
+        return static_cast<usize>(std::upper_bound(_keys.begin(), _keys.end(), key, LESS{}) - _keys.begin());
+    }
+
+    DArray<K> _keys;
+    DArray<V> _values;
+};
+
+} // containers namespace
+} // gravity namespace
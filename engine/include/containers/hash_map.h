@@ -0,0 +1,426 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(Q_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace gravity {
+namespace containers {
+
+/// @brief Scramble a hash so every bit depends on every input bit.
+/// std::hash of pointers and integers is the identity on common standard
+/// libraries, which would leave the low and high bits the table relies on nearly constant.
+PINLINE u64 hash_mix(u64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/// @brief Default hasher for HashMap keys
+template <typename K>
+struct Hash {
+    u64 operator()(const K& key) const {
+        if constexpr (std::is_enum_v<K>) {
+            return hash_mix(static_cast<u64>(key));
+        } else if constexpr (std::is_pointer_v<K>) {
+            return hash_mix(static_cast<u64>(reinterpret_cast<uintptr_t>(key)));
+        } else if constexpr (std::is_integral_v<K>) {
+            return hash_mix(static_cast<u64>(key));
+        } else {
+            return hash_mix(static_cast<u64>(std::hash<K>{}(key)));
+        }
+    }
+};
+
+template <>
+struct Hash<std::string> {
+    u64 operator()(const std::string& key) const {
+        return hash_mix(static_cast<u64>(std::hash<std::string_view>{}(key)));
+    }
+};
+
+/// @brief Metadata for a group of consecutive slots, matched 16 at a time
+class HashMapGroup {
+public:
+    static constexpr usize WIDTH = 16;
+
+    // Control byte values. Full slots store the low 7 bits of their hash
+    static constexpr i8 EMPTY = -128;
+    static constexpr i8 DELETED = -2;
+
+    explicit HashMapGroup(const i8* ctrl) {
+#if defined(Q_SSE2)
+        _ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        std::memcpy(_ctrl, ctrl, WIDTH);
+#endif
+    }
+
+    /// @brief Bit i is set if slot i holds the 7 bit hash `h2`
+    u32 match(i8 h2) const {
+#if defined(Q_SSE2)
+        return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+#else
+        u32 mask = 0;
+        for (u32 i = 0; i < WIDTH; i++) {
+            mask |= static_cast<u32>(_ctrl[i] == h2) << i;
+        }
+        return mask;
+#endif
+    }
+
+    u32 match_empty() const { return match(EMPTY); }
+
+    /// @brief Bit i is set if slot i is free. Only free slots have the sign bit set
+    u32 match_free() const {
+#if defined(Q_SSE2)
+        return static_cast<u32>(_mm_movemask_epi8(_ctrl));
+#else
+        u32 mask = 0;
+        for (u32 i = 0; i < WIDTH; i++) {
+            mask |= static_cast<u32>(_ctrl[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+private:
+#if defined(Q_SSE2)
+    __m128i _ctrl;
+#else
+    i8 _ctrl[WIDTH];
+#endif
+};
+
+/// @brief Open addressing hash map in the style of SwissTable.
+/// Slots are stored flat with one control byte each holding 7 bits of the
+/// slot's hash; lookups compare a whole group of control bytes at once and only
+/// touch the slots whose bits match, so a hit usually costs one key compare and
+/// no pointer chasing. Memory comes from memory::allocate under a tag
+/// (HASHTABLE by default). Elements move on rehash, so references and iterators
+/// are invalidated by any insertion that grows the table.
+template <typename K, typename V, typename HASH = Hash<K>, typename EQUAL = std::equal_to<K>>
+class HashMap {
+public:
+    using value_type = std::pair<K, V>;   // the key must not be modified through iteration
+
+    template <bool CONST>
+    class Iterator {
+    public:
+        using reference = std::conditional_t<CONST, const value_type&, value_type&>;
+        using pointer = std::conditional_t<CONST, const value_type*, value_type*>;
+
+        Iterator() = default;
+        Iterator(const i8* ctrl, pointer slot, const i8* end) : _ctrl(ctrl), _slot(slot), _end(end) { _skip_free(); }
+        template <bool OTHER> requires (CONST && !OTHER)
+        Iterator(const Iterator<OTHER>& other) : _ctrl(other._ctrl), _slot(other._slot), _end(other._end) {}
+
+        reference operator*() const { return *_slot; }
+        pointer operator->() const { return _slot; }
+        Iterator& operator++() { _ctrl++; _slot++; _skip_free(); return *this; }
+        Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+        bool operator==(const Iterator& other) const { return _ctrl == other._ctrl; }
+        bool operator!=(const Iterator& other) const { return _ctrl != other._ctrl; }
+    private:
+        friend class HashMap;
+        template <bool> friend class Iterator;
+
+        void _skip_free() {
+            while (_ctrl != _end && *_ctrl < 0) {
+                _ctrl++;
+                _slot++;
+            }
+        }
+
+        const i8* _ctrl { nullptr };
+        pointer _slot { nullptr };
+        const i8* _end { nullptr };
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    explicit HashMap(memory::tag memory_tag = memory::tag::HASHTABLE) : _tag(memory_tag) {}
+
+    HashMap(HashMap&& other) noexcept { _take(other); }
+    HashMap& operator=(HashMap&& other) noexcept {
+        if (this != &other) {
+            _destroy();
+            _take(other);
+        }
+        return *this;
+    }
+
+    ~HashMap() { _destroy(); }
+
+    usize size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    usize capacity() const { return _capacity; }
+
+    iterator begin() { return iterator(_ctrl, _slots, _ctrl + _capacity); }
+    iterator end() { return iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+    const_iterator begin() const { return const_iterator(_ctrl, _slots, _ctrl + _capacity); }
+    const_iterator end() const { return const_iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity); }
+
+    iterator find(const K& key) {
+        usize index = _find(key, HASH{}(key));
+        return index == NOT_FOUND ? end() : _iterator_at(index);
+    }
+    const_iterator find(const K& key) const {
+        usize index = _find(key, HASH{}(key));
+        return index == NOT_FOUND ? end() : const_iterator(_ctrl + index, _slots + index, _ctrl + _capacity);
+    }
+    bool contains(const K& key) const { return _find(key, HASH{}(key)) != NOT_FOUND; }
+
+    /// @brief Insert `key` with a value built from `args` unless it is already present
+    /// @return Iterator to the element for `key` and whether it was inserted
+    template <typename KEY, typename... ARGS>
+    std::pair<iterator, bool> try_emplace(KEY&& key, ARGS&&... args) {
+        u64 hash = HASH{}(key);
+        usize index = _find(key, hash);
+        if (index != NOT_FOUND) {
+            return { _iterator_at(index), false };
+        }
+
+        index = _prepare_insert(hash);
+        new (_slots + index) value_type(
+            std::piecewise_construct,
+            std::forward_as_tuple(std::forward<KEY>(key)),
+            std::forward_as_tuple(std::forward<ARGS>(args)...)
+        );
+        return { _iterator_at(index), true };
+    }
+
+    std::pair<iterator, bool> insert(value_type value) {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+    V& operator[](K&& key) { return try_emplace(std::move(key)).first->second; }
+
+    /// @brief Remove the element for `key`
+    /// @return Number of elements removed
+    usize erase(const K& key) {
+        usize index = _find(key, HASH{}(key));
+        if (index == NOT_FOUND) {
+            return 0;
+        }
+        _erase_at(index);
+        return 1;
+    }
+
+    /// @brief Remove the element at `it`
+    /// @return Iterator to the next element
+    iterator erase(iterator it) {
+        usize index = static_cast<usize>(it._ctrl - _ctrl);
+        _erase_at(index);
+        return ++it;
+    }
+
+    /// @brief Remove every element, keeping the storage
+    void clear() {
+        for (usize i = 0; i < _capacity; i++) {
+            if (_ctrl[i] >= 0) {
+                _slots[i].~value_type();
+            }
+        }
+        if (_capacity) {
+            std::memset(_ctrl, HashMapGroup::EMPTY, _capacity + HashMapGroup::WIDTH);
+        }
+        _size = 0;
+        _growth_left = _max_load(_capacity);
+    }
+
+    /// @brief Make room for `count` elements without rehashing
+    void reserve(usize count) {
+        usize capacity = HashMapGroup::WIDTH;
+        while (_max_load(capacity) < count) {
+            capacity *= 2;
+        }
+        if (capacity > _capacity) {
+            _rehash(capacity);
+        }
+    }
+private:
+    static constexpr usize NOT_FOUND = ~usize(0);
+
+    // Tables are kept at most 7/8 full
+    static constexpr usize _max_load(usize capacity) { return capacity - capacity / 8; }
+
+    static i8 _h2(u64 hash) { return static_cast<i8>(hash & 0x7f); }
+    static usize _h1(u64 hash) { return static_cast<usize>(hash >> 7); }
+
+    /// @brief Control bytes of an empty table, so lookups need no capacity check
+    static const i8* _empty_group() {
+        alignas(16) static const i8 group[HashMapGroup::WIDTH] = {
+            HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY,
+            HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY,
+            HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY,
+            HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY, HashMapGroup::EMPTY,
+        };
+        return group;
+    }
+
+    iterator _iterator_at(usize index) { return iterator(_ctrl + index, _slots + index, _ctrl + _capacity); }
+
+    /// @brief Probe for `key`
+    /// @return Slot index, NOT_FOUND if absent
+    usize _find(const K& key, u64 hash) const {
+        const i8* ctrl = _capacity ? _ctrl : _empty_group();
+        usize mask = _capacity ? _capacity - 1 : 0;
+        usize pos = _h1(hash) & mask;
+        i8 h2 = _h2(hash);
+
+        for (usize step = HashMapGroup::WIDTH;; step += HashMapGroup::WIDTH) {
+            HashMapGroup group(ctrl + pos);
+            for (u32 bits = group.match(h2); bits; bits &= bits - 1) {
+                usize index = (pos + std::countr_zero(bits)) & mask;
+                if (EQUAL{}(_slots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (group.match_empty()) {
+                return NOT_FOUND;
+            }
+            // Triangular probing visits every group once when the capacity is a power of two
+            pos = (pos + step) & mask;
+        }
+    }
+
+    /// @brief First free slot on the probe sequence of `hash`
+    usize _find_free(u64 hash) const {
+        usize mask = _capacity - 1;
+        usize pos = _h1(hash) & mask;
+        for (usize step = HashMapGroup::WIDTH;; step += HashMapGroup::WIDTH) {
+            u32 bits = HashMapGroup(_ctrl + pos).match_free();
+            if (bits) {
+                return (pos + std::countr_zero(bits)) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    /// @brief Claim a slot for a new element with `hash`, growing if needed
+    usize _prepare_insert(u64 hash) {
+        if (_growth_left == 0) {
+            // Mostly tombstones: rebuild at the same size instead of doubling
+            usize capacity = _capacity == 0 ? HashMapGroup::WIDTH
+                : (_size * 2 < _max_load(_capacity) ? _capacity : _capacity * 2);
+            _rehash(capacity);
+        }
+
+        usize index = _find_free(hash);
+        if (_ctrl[index] == HashMapGroup::EMPTY) {
+            _growth_left--;
+        }
+        _set_ctrl(index, _h2(hash));
+        _size++;
+        return index;
+    }
+
+    /// @brief Write a control byte and its mirror past the end of the table
+    void _set_ctrl(usize index, i8 value) {
+        _ctrl[index] = value;
+        if (index < HashMapGroup::WIDTH) {
+            _ctrl[_capacity + index] = value;
+        }
+    }
+
+    void _erase_at(usize index) {
+        _slots[index].~value_type();
+        _set_ctrl(index, HashMapGroup::DELETED);
+        _size--;
+    }
+
+    static usize _slots_offset(usize capacity) {
+        usize ctrl_bytes = capacity + HashMapGroup::WIDTH;
+        return (ctrl_bytes + (alignof(value_type) - 1)) & ~(alignof(value_type) - 1);
+    }
+    static usize _allocation_size(usize capacity) { return _slots_offset(capacity) + capacity * sizeof(value_type); }
+    static constexpr usize _allocation_alignment() { return std::max<usize>(alignof(value_type), 16); }
+
+    /// @brief Move every element into a table of `capacity` slots
+    void _rehash(usize capacity) {
+        i8* old_ctrl = _ctrl;
+        value_type* old_slots = _slots;
+        usize old_capacity = _capacity;
+
+        u8* memory = static_cast<u8*>(memory::allocate(_allocation_size(capacity), _allocation_alignment(), _tag));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        _ctrl = reinterpret_cast<i8*>(memory);
+        _slots = reinterpret_cast<value_type*>(memory + _slots_offset(capacity));
+        _capacity = capacity;
+        std::memset(_ctrl, HashMapGroup::EMPTY, capacity + HashMapGroup::WIDTH);
+        _growth_left = _max_load(capacity) - _size;
+
+        for (usize i = 0; i < old_capacity; i++) {
+            if (old_ctrl[i] >= 0) {
+                u64 hash = HASH{}(old_slots[i].first);
+                usize index = _find_free(hash);
+                _set_ctrl(index, _h2(hash));
+                new (_slots + index) value_type(std::move(old_slots[i]));
+                old_slots[i].~value_type();
+            }
+        }
+
+        if (old_capacity) {
+            memory::free(old_ctrl, _allocation_size(old_capacity), _allocation_alignment(), _tag);
+        }
+    }
+
+    void _destroy() {
+        if (!_capacity) return;
+        for (usize i = 0; i < _capacity; i++) {
+            if (_ctrl[i] >= 0) {
+                _slots[i].~value_type();
+            }
+        }
+        memory::free(_ctrl, _allocation_size(_capacity), _allocation_alignment(), _tag);
+        _ctrl = nullptr;
+        _slots = nullptr;
+        _capacity = 0;
+        _size = 0;
+        _growth_left = 0;
+    }
+
+    void _take(HashMap& other) {
+        _ctrl = other._ctrl;
+        _slots = other._slots;
+        _capacity = other._capacity;
+        _size = other._size;
+        _growth_left = other._growth_left;
+        _tag = other._tag;
+        other._ctrl = nullptr;
+        other._slots = nullptr;
+        other._capacity = 0;
+        other._size = 0;
+        other._growth_left = 0;
+    }
+
+    i8* _ctrl { nullptr };             // capacity control bytes, then a mirror of the first group
+    value_type* _slots { nullptr };
+    usize _capacity { 0 };             // power of two, at least one group, or 0 before the first insert
+    usize _size { 0 };
+    usize _growth_left { 0 };          // inserts into empty slots left before a rehash
+    memory::tag _tag { memory::tag::HASHTABLE };
+
+    HashMap(const HashMap&) = delete;
+    HashMap& operator=(const HashMap&) = delete;
+};
+
+} // containers namespace
+} // gravity namespace
@@ -0,0 +1,347 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gravity {
+namespace containers {
+
+/// @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+/// Each side owns one index on its own cache line and keeps a cached copy of the
+/// other side's, so the shared line is only read when the cached view says
+/// the queue is full (producer) or empty (consumer). The capacity is rounded up
+/// to a power of two; memory comes from memory::allocate under a tag (RING_QUEUE
+/// by default).
+template <typename T>
+class SpscRingQueue {
+public:
+    /// @param capacity Number of elements the queue holds. Rounded up to a power of two
+    /// @param memory_tag Tag the storage is accounted to
+    explicit SpscRingQueue(usize capacity, memory::tag memory_tag = memory::tag::RING_QUEUE)
+        : _capacity(std::bit_ceil(std::max<usize>(capacity, 2)))
+        , _mask(_capacity - 1)
+        , _tag(memory_tag)
+    {
+        _slots = static_cast<T*>(memory::allocate(_capacity * sizeof(T), ALIGNMENT, _tag));
+        if (!_slots) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~SpscRingQueue() {
+        usize head = _head.load(std::memory_order_relaxed);
+        usize tail = _tail.load(std::memory_order_relaxed);
+        for (; head != tail; head++) {
+            _slots[head & _mask].~T();
+        }
+        memory::free(_slots, _capacity * sizeof(T), ALIGNMENT, _tag);
+    }
+
+    /// @brief Construct an element at the back. Producer only
+    /// @return false if the queue is full
+    template <typename... ARGS>
+    bool try_emplace(ARGS&&... args) {
+        usize tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cached_head == _capacity) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail - _cached_head == _capacity) {
+                return false;
+            }
+        }
+        new (_slots + (tail & _mask)) T(std::forward<ARGS>(args)...);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    /// @brief Move up to `count` elements from `values` to the back with one index update. Producer only
+    /// @return Number of elements pushed; the rest of `values` is untouched
+    usize try_push_batch(T* values, usize count) {
+        usize tail = _tail.load(std::memory_order_relaxed);
+        if (_capacity - (tail - _cached_head) < count) {
+            _cached_head = _head.load(std::memory_order_acquire);
+        }
+        usize pushed = std::min(count, _capacity - (tail - _cached_head));
+        for (usize i = 0; i < pushed; i++) {
+            new (_slots + ((tail + i) & _mask)) T(std::move(values[i]));
+        }
+        if (pushed) {
+            _tail.store(tail + pushed, std::memory_order_release);
+        }
+        return pushed;
+    }
+
+    /// @brief Move the front element into `out`. Consumer only
+    /// @return false if the queue is empty
+    bool try_pop(T& out) {
+        usize head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head == _cached_tail) {
+                return false;
+            }
+        }
+        T& slot = _slots[head & _mask];
+        out = std::move(slot);
+        slot.~T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Move up to `max_count` elements from the front into `out` with one index update. Consumer only
+    /// @return Number of elements popped
+    usize try_pop_batch(T* out, usize max_count) {
+        usize head = _head.load(std::memory_order_relaxed);
+        if (_cached_tail - head < max_count) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+        }
+        usize popped = std::min(max_count, _cached_tail - head);
+        for (usize i = 0; i < popped; i++) {
+            T& slot = _slots[(head + i) & _mask];
+            out[i] = std::move(slot);
+            slot.~T();
+        }
+        if (popped) {
+            _head.store(head + popped, std::memory_order_release);
+        }
+        return popped;
+    }
+
+    /// @brief Call `fn(T&)` on every queued element in place, then drop them all with one index update.
+    /// Useful when elements are too big to move out one by one. Consumer only
+    /// @return Number of elements consumed
+    template <typename FN>
+    usize consume_all(FN&& fn) {
+        usize head = _head.load(std::memory_order_relaxed);
+        _cached_tail = _tail.load(std::memory_order_acquire);
+        usize count = _cached_tail - head;
+        for (usize i = 0; i < count; i++) {
+            T& slot = _slots[(head + i) & _mask];
+            fn(slot);
+            slot.~T();
+        }
+        if (count) {
+            _head.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// @brief Number of queued elements. Exact only when neither side is running
+    usize size_approx() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size_approx() == 0; }
+    usize capacity() const { return _capacity; }
+private:
+    static constexpr usize ALIGNMENT = std::max<usize>(alignof(T), memory::CACHE_LINE_SIZE);
+
+    // Consumer side
+    alignas(memory::CACHE_LINE_SIZE) std::atomic<usize> _head { 0 };   // next element to pop
+    usize _cached_tail { 0 };                                          // consumer's last view of _tail
+
+    // Producer side
+    alignas(memory::CACHE_LINE_SIZE) std::atomic<usize> _tail { 0 };   // next slot to push into
+    usize _cached_head { 0 };                                          // producer's last view of _head
+
+    // Read-only after construction
+    alignas(memory::CACHE_LINE_SIZE) T* _slots { nullptr };
+    usize _capacity;
+    usize _mask;
+    memory::tag _tag;
+
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+};
+
+/// @brief Bounded lock-free queue for any number of producer and consumer threads
+/// (Dmitry Vyukov's design). Every cell carries a sequence number saying which
+/// lap of the ring it is ready for, so a thread claims a cell with a single CAS
+/// on the shared index and then works on it without touching the other side.
+/// Batch operations claim a run of ready cells with one CAS. The capacity is
+/// rounded up to a power of two; memory comes from memory::allocate under a tag
+/// (RING_QUEUE by default).
+template <typename T>
+class MpmcRingQueue {
+public:
+    /// @param capacity Number of elements the queue holds. Rounded up to a power of two
+    /// @param memory_tag Tag the storage is accounted to
+    explicit MpmcRingQueue(usize capacity, memory::tag memory_tag = memory::tag::RING_QUEUE)
+        : _capacity(std::bit_ceil(std::max<usize>(capacity, 2)))
+        , _mask(_capacity - 1)
+        , _tag(memory_tag)
+    {
+        _cells = static_cast<Cell*>(memory::allocate(_capacity * sizeof(Cell), ALIGNMENT, _tag));
+        if (!_cells) {
+            throw std::bad_alloc();
+        }
+        for (usize i = 0; i < _capacity; i++) {
+            new (&_cells[i].sequence) std::atomic<usize>(i);
+        }
+    }
+
+    ~MpmcRingQueue() {
+        usize head = _head.load(std::memory_order_relaxed);
+        usize tail = _tail.load(std::memory_order_relaxed);
+        for (; head != tail; head++) {
+            _cells[head & _mask].value()->~T();
+        }
+        memory::free(_cells, _capacity * sizeof(Cell), ALIGNMENT, _tag);
+    }
+
+    /// @brief Construct an element at the back
+    /// @return false if the queue is full
+    template <typename... ARGS>
+    bool try_emplace(ARGS&&... args) {
+        usize pos = _tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            usize sequence = cell->sequence.load(std::memory_order_acquire);
+            i64 lap = static_cast<i64>(sequence - pos);
+            if (lap == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lap < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->value()) T(std::forward<ARGS>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value) { return try_emplace(value); }
+    bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+    /// @brief Move up to `count` elements from `values` to the back, claiming their cells with one CAS
+    /// @return Number of elements pushed; the rest of `values` is untouched
+    usize try_push_batch(T* values, usize count) {
+        if (count == 0) return 0;
+        usize pos = _tail.load(std::memory_order_relaxed);
+        usize claimed;
+        for (;;) {
+            claimed = _ready_run(pos, count, 0);
+            if (claimed == 0) {
+                if (static_cast<i64>(_cells[pos & _mask].sequence.load(std::memory_order_acquire) - pos) < 0) {
+                    return 0;
+                }
+                pos = _tail.load(std::memory_order_relaxed);
+            } else if (_tail.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (usize i = 0; i < claimed; i++) {
+            Cell& cell = _cells[(pos + i) & _mask];
+            new (cell.value()) T(std::move(values[i]));
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    /// @brief Move the front element into `out`
+    /// @return false if the queue is empty
+    bool try_pop(T& out) {
+        usize pos = _head.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            usize sequence = cell->sequence.load(std::memory_order_acquire);
+            i64 lap = static_cast<i64>(sequence - (pos + 1));
+            if (lap == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lap < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        T* value = cell->value();
+        out = std::move(*value);
+        value->~T();
+        cell->sequence.store(pos + _capacity, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Move up to `max_count` elements from the front into `out`, claiming their cells with one CAS
+    /// @return Number of elements popped
+    usize try_pop_batch(T* out, usize max_count) {
+        if (max_count == 0) return 0;
+        usize pos = _head.load(std::memory_order_relaxed);
+        usize claimed;
+        for (;;) {
+            claimed = _ready_run(pos, max_count, 1);
+            if (claimed == 0) {
+                if (static_cast<i64>(_cells[pos & _mask].sequence.load(std::memory_order_acquire) - (pos + 1)) < 0) {
+                    return 0;
+                }
+                pos = _head.load(std::memory_order_relaxed);
+            } else if (_head.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (usize i = 0; i < claimed; i++) {
+            Cell& cell = _cells[(pos + i) & _mask];
+            T* value = cell.value();
+            out[i] = std::move(*value);
+            value->~T();
+            cell.sequence.store(pos + i + _capacity, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    /// @brief Number of queued elements. Only a hint while other threads are running
+    usize size_approx() const {
+        usize tail = _tail.load(std::memory_order_acquire);
+        usize head = _head.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    bool empty() const { return size_approx() == 0; }
+    usize capacity() const { return _capacity; }
+private:
+    static constexpr usize ALIGNMENT = std::max<usize>(alignof(T), memory::CACHE_LINE_SIZE);
+
+    struct Cell {
+        std::atomic<usize> sequence;   // pos when free for the push of pos, pos + 1 once it holds that element
+        alignas(T) u8 storage[sizeof(T)];
+
+        T* value() { return reinterpret_cast<T*>(storage); }
+    };
+
+    /// @brief Length of the run of cells from `pos` whose sequence is their position plus `offset`,
+    /// i.e. free for pushing (0) or holding an element (1). At most `max_count`
+    usize _ready_run(usize pos, usize max_count, usize offset) const {
+        usize count = 0;
+        while (count < max_count
+            && _cells[(pos + count) & _mask].sequence.load(std::memory_order_acquire) == pos + count + offset) {
+            count++;
+        }
+        return count;
+    }
+
+    alignas(memory::CACHE_LINE_SIZE) std::atomic<usize> _tail { 0 };   // next position to push
+    alignas(memory::CACHE_LINE_SIZE) std::atomic<usize> _head { 0 };   // next position to pop
+    alignas(memory::CACHE_LINE_SIZE) Cell* _cells { nullptr };
+    usize _capacity;
+    usize _mask;
+    memory::tag _tag;
+
+    MpmcRingQueue(const MpmcRingQueue&) = delete;
+    MpmcRingQueue& operator=(const MpmcRingQueue&) = delete;
+};
+
+} // containers namespace
+} // gravity namespace
@@ -0,0 +1,146 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "memory/memory.h"
+#include "containers/darray.h"
+
+#include <utility>
+
+namespace gravity {
+namespace containers {
+
+/// @brief Reference to an element of a SlotMap<T>. Stays valid while the
+/// element moves around the dense storage; becomes stale, rather than
+/// dangling, once the element is erased
+template <typename T>
+struct SlotHandle {
+    static constexpr u32 INVALID_INDEX = ~0u;
+
+    u32 index { INVALID_INDEX };
+    u32 generation { 0 };
+
+    bool valid() const { return index != INVALID_INDEX; }
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+/// @brief Objects stored contiguously and referenced through generational handles.
+/// Values live packed in a dense array, so iterating them is a linear walk.
+/// Handles index a sparse slot array that points into the dense one. Erasing
+/// moves the last value into the hole and bumps the slot's generation, so
+/// stale handles are rejected in O(1) and slots can be reused safely.
+/// Pointers and iterators to values are invalidated by insert and erase;
+/// handles are not. Memory comes from memory::allocate under a tag (DARRAY by default).
+template <typename T>
+class SlotMap {
+public:
+    using Handle = SlotHandle<T>;
+
+    explicit SlotMap(memory::tag memory_tag = memory::tag::DARRAY)
+        : _values(memory_tag)
+        , _dense_slots(memory_tag)
+        , _slots(memory_tag)
+        {}
+
+    /// @brief Construct a value in the map
+    /// @return Handle to the new value
+    template <typename... ARGS>
+    Handle emplace(ARGS&&... args) {
+        u32 index = _free_head;
+        if (index != Handle::INVALID_INDEX) {
+            _free_head = _slots[index].dense;
+        } else {
+            index = static_cast<u32>(_slots.size());
+            _slots.push_back({ 0, 0 });
+        }
+
+        _values.emplace_back(std::forward<ARGS>(args)...);
+        _dense_slots.push_back(index);
+        _slots[index].dense = static_cast<u32>(_values.size() - 1);
+        return { index, _slots[index].generation };
+    }
+
+    Handle insert(const T& value) { return emplace(value); }
+    Handle insert(T&& value) { return emplace(std::move(value)); }
+
+    /// @brief Remove a value. Stale or invalid handles are ignored
+    /// @return true if a value was removed
+    bool erase(Handle handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+
+        Slot& slot = _slots[handle.index];
+        u32 dense = slot.dense;
+        u32 last = static_cast<u32>(_values.size() - 1);
+        if (dense != last) {
+            _values[dense] = std::move(_values[last]);
+            _dense_slots[dense] = _dense_slots[last];
+            _slots[_dense_slots[dense]].dense = dense;
+        }
+        _values.pop_back();
+        _dense_slots.pop_back();
+
+        slot.generation++;
+        slot.dense = _free_head;
+        _free_head = handle.index;
+        return true;
+    }
+
+    /// @brief Whether `handle` refers to a value in the map
+    bool contains(Handle handle) const {
+        return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+    }
+
+    /// @brief Value for a handle
+    /// @return Pointer valid until the next insert or erase. nullptr for stale handles
+    T* get(Handle handle) { return contains(handle) ? &_values[_slots[handle.index].dense] : nullptr; }
+    const T* get(Handle handle) const { return contains(handle) ? &_values[_slots[handle.index].dense] : nullptr; }
+
+    /// @brief Handle of the value at a position in the dense storage
+    Handle handle_at(usize dense_index) const {
+        u32 index = _dense_slots[dense_index];
+        return { index, _slots[index].generation };
+    }
+
+    /// @brief Remove every value. Every handle goes stale
+    void clear() {
+        for (u32 index : _dense_slots) {
+            _slots[index].generation++;
+            _slots[index].dense = _free_head;
+            _free_head = index;
+        }
+        _values.clear();
+        _dense_slots.clear();
+    }
+
+    void reserve(usize count) {
+        _values.reserve(count);
+        _dense_slots.reserve(count);
+        _slots.reserve(count);
+    }
+
+    usize size() const { return _values.size(); }
+    bool empty() const { return _values.empty(); }
+
+    // Dense iteration, in no particular order
+    T* begin() { return _values.begin(); }
+    T* end() { return _values.end(); }
+    const T* begin() const { return _values.begin(); }
+    const T* end() const { return _values.end(); }
+    T& operator[](usize dense_index) { return _values[dense_index]; }
+    const T& operator[](usize dense_index) const { return _values[dense_index]; }
+private:
+    struct Slot {
+        u32 dense;        // position of the value in _values, or the next free slot while unused
+        u32 generation;   // bumped on erase so old handles go stale
+    };
+
+    DArray<T> _values;             // values, packed
+    DArray<u32> _dense_slots;      // slot of each value in _values
+    DArray<Slot> _slots;           // indexed by handle
+    u32 _free_head { Handle::INVALID_INDEX };
+};
+
+} // containers namespace
+} // gravity namespace
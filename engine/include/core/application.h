@@ -8,8 +8,6 @@
 #include "events/events.h"
 #include "renderer/renderer.h"
 
-#include <map>
-
 namespace gravity {
 namespace core {
 
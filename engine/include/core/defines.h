@@ -39,13 +39,18 @@
 // #endif
 // #endif
 
+// SIMD. SSE2 is part of every x86-64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define Q_SSE2 1
+#endif
+
 // Inlining
 #ifdef _MSC_VER
 #define PINLINE __forceinline
 #define PNOINLINE __declspec(noinline)
 #else
 #define PINLINE static inline
-#define PNOINLINE 
+#define PNOINLINE __attribute__((noinline))
 #endif
 
 #ifndef DISABLE_COPY
@@ -2,9 +2,18 @@
 #include "core/defines.h"
 #include "core/types.h"
 #include "platform/platform.h"
-#include <functional>
-#include <vector>
-#include <queue>
+#include "memory/memory.h"
+#include "containers/darray.h"
+#include "containers/flat_map.h"
+#include "containers/ring_queue.h"
+#include "core/string_id.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <unordered_map>
 
 // using namespace gravity::core::types;
@@ -31,6 +40,9 @@ enum class EventType {
     MOUSE_WHEEL,
 };
 
+/// @brief Number of EventType values
+constexpr u32 EVENT_TYPES = static_cast<u32>(EventType::MOUSE_WHEEL) + 1;
+
 /// @brief The priorities each event can have
 enum class EventPriority {
     CRITICAL = 0,   // Must be handled immediately (e.g., crash events)
@@ -40,11 +52,14 @@ enum class EventPriority {
     DEBUG = 4       // Logging, development events
 };
 
+/// @brief Number of EventPriority levels
+constexpr u32 EVENT_PRIORITIES = static_cast<u32>(EventPriority::DEBUG) + 1;
+
 /// @brief Information relating to propogation of events
 struct EventPropagation {
     bool handled = false;
     bool propogate = true;
-    bool async = false; // TODO: async
+    bool async = false; // every callback for this event runs on the async workers
 };
 
 /// @brief Interface and base class for events
@@ -72,44 +87,293 @@ struct EventContext {
 };
 
 // using EventCallback = std::function<bool(Event*, EventContext&)>;
-using EventCallback = std::function<bool(Event&, EventContext&)>;
+/// @brief Function called for an event. Plain function pointer so dispatch is a direct call
+using EventCallback = bool (*)(Event&, EventContext&);
 
 struct CallbackData {
     EventCallback callback;
-    std::string handler_name;
+    StringId handler_name;
     EventPriority priority;
     u32 order_with_priority;
+    bool async;     // run on the async workers instead of the polling thread
 
-    bool operator=(const CallbackData& other) const {
+    bool operator<(const CallbackData& other) const {
         if (priority != other.priority)
             return priority < other.priority;
 
         return order_with_priority < other.order_with_priority;
     }
+};
 
-    bool operator<(const CallbackData& other) const {
-        if (priority != other.priority)
-            return priority < other.priority;
+/// @brief Callbacks for one event type. Each window's callbacks sit in one
+/// contiguous run of `callbacks`, already in dispatch order, so dispatching
+/// is a lookup of the window's run followed by a linear loop.
+struct DispatchList {
+    /// @brief Position of a window's callbacks in `callbacks`
+    struct Range {
+        u32 begin;
+        u32 count;
+    };
 
-        return order_with_priority < other.order_with_priority;
+    containers::FlatMap<const platform::Window*, Range> windows { memory::tag::HASHTABLE };
+    containers::DArray<CallbackData> callbacks { memory::tag::HASHTABLE };
+};
+
+/// @brief Largest event that can be posted, in bytes
+constexpr usize MAX_EVENT_SIZE = 256;
+/// @brief Alignment of every event in an EventBuffer
+constexpr usize EVENT_ALIGNMENT = 16;
+/// @brief Starting size in bytes of each EventBuffer
+constexpr usize EVENT_BUFFER_SIZE = 16 * 1024;
+/// @brief Starting size in bytes of the buffer for immediate events
+constexpr usize IMMEDIATE_EVENT_BUFFER_SIZE = 1024;
+/// @brief Callbacks each async worker can have queued before posting waits for it
+constexpr usize ASYNC_QUEUE_CAPACITY = 1024;
+/// @brief Most async worker threads started, whatever the core count
+constexpr u32 MAX_ASYNC_WORKERS = 4;
+/// @brief Events a thread other than the polling thread can have in flight before further posts spill into a locked list
+constexpr usize PRODUCER_QUEUE_CAPACITY = 256;
+/// @brief Most threads other than the polling thread with a lock-free queue of their own at once. Any more share one locked queue
+constexpr u32 MAX_EVENT_PRODUCERS = 32;
+
+/// @brief Events stored by value, back to back, in memory that is reused every
+/// frame. Posting constructs the event in place; events are destroyed by clear().
+/// A buffer that runs out of room chains overflow blocks for the rest of the
+/// frame and is resized to fit them on the next clear(), so a steady stream of
+/// events stops allocating after the first busy frame.
+class EventBuffer {
+public:
+    explicit EventBuffer(usize capacity = EVENT_BUFFER_SIZE);
+    ~EventBuffer();
+
+    /// @brief Storage for an event of `size` bytes, aligned to EVENT_ALIGNMENT
+    void* allocate(usize size) {
+        usize record = _record_size(size);
+        if (_used + record > _capacity) {
+            return _allocate_overflow(record);
+        }
+        u8* header = _data + _used;
+        *reinterpret_cast<usize*>(header) = record;
+        _used += record;
+        _count++;
+        return header + RECORD_HEADER;
+    }
+
+    /// @brief Call `fn(Event&)` on every event in the order they were posted
+    template <typename FN>
+    void for_each(FN&& fn) {
+        _for_each_in(_data, _used, fn);
+        for (Overflow* block = _overflow_head; block; block = block->next) {
+            _for_each_in(_overflow_data(block), block->used, fn);
+        }
+    }
+
+    /// @brief Destroy every event and fold any overflow blocks into the main block
+    void clear();
+
+    usize count() const { return _count; }
+    usize capacity() const { return _capacity; }
+private:
+    // Each event is preceded by its record size, padded so the event stays aligned
+    static constexpr usize RECORD_HEADER = EVENT_ALIGNMENT;
+
+    struct Overflow {
+        Overflow* next;
+        usize capacity;
+        usize used;
+    };
+    static constexpr usize OVERFLOW_HEADER = (sizeof(Overflow) + EVENT_ALIGNMENT - 1) & ~(EVENT_ALIGNMENT - 1);
+
+    static usize _record_size(usize size) {
+        return RECORD_HEADER + ((size + EVENT_ALIGNMENT - 1) & ~(EVENT_ALIGNMENT - 1));
+    }
+    static u8* _overflow_data(Overflow* block) { return reinterpret_cast<u8*>(block) + OVERFLOW_HEADER; }
+
+    template <typename FN>
+    static void _for_each_in(u8* data, usize used, FN& fn) {
+        for (usize offset = 0; offset < used; offset += *reinterpret_cast<usize*>(data + offset)) {
+            fn(*std::launder(reinterpret_cast<Event*>(data + offset + RECORD_HEADER)));
+        }
+    }
+
+    void* _allocate_overflow(usize record);
+
+    u8* _data { nullptr };
+    usize _capacity { 0 };
+    usize _used { 0 };
+    usize _count { 0 };
+    Overflow* _overflow_head { nullptr };
+    Overflow* _overflow_tail { nullptr };
+
+    EventBuffer(const EventBuffer&) = delete;
+    EventBuffer& operator=(const EventBuffer&) = delete;
+};
+
+/// @brief Worker threads that run async callbacks. Each worker drains its own
+/// single producer queue, and every callback for one (window, EventType) stream
+/// goes to the same worker, so a stream's callbacks run in the order they were
+/// submitted. Only the polling thread submits. Callbacks must only touch state
+/// that is safe to use from another thread.
+class AsyncDispatcher {
+public:
+    explicit AsyncDispatcher(u32 worker_count);
+    ~AsyncDispatcher();
+
+    /// @brief Queue `callback(ev)` on the worker that owns `ev`'s stream.
+    /// `ev` must stay alive until wait() returns
+    void submit(EventCallback callback, Event& ev);
+
+    /// @brief Block until every submitted callback has finished
+    void wait();
+
+    u32 worker_count() const { return _worker_count; }
+private:
+    struct Job {
+        EventCallback callback;
+        Event* event;
+    };
+
+    struct alignas(memory::CACHE_LINE_SIZE) Worker {
+        Worker() : jobs(ASYNC_QUEUE_CAPACITY) {}
+
+        containers::SpscRingQueue<Job> jobs;
+        std::atomic<u32> signal { 0 };   // bumped on every submit so a sleeping worker wakes
+        std::thread thread;
+    };
+
+    void _run(Worker& worker);
+
+    std::unique_ptr<Worker[]> _workers;
+    u32 _worker_count;
+    alignas(memory::CACHE_LINE_SIZE) std::atomic<u32> _pending { 0 };
+    std::atomic<bool> _stopping { false };
+};
+
+/// @brief An event posted from another thread, held by value until the polling thread moves it into its event buffer
+struct QueuedEvent {
+    template <typename EVENT, typename E>
+    QueuedEvent(std::in_place_type_t<EVENT>, E&& event)
+        : move_to(&_move_to<EVENT>)
+        , size(static_cast<u32>(sizeof(EVENT)))
+    {
+        new (storage) EVENT(std::forward<E>(event));
+    }
+
+    /// @brief Take over `other`'s event, leaving `other` empty. Used when a list of queued events grows
+    QueuedEvent(QueuedEvent&& other) noexcept
+        : move_to(other.move_to)
+        , size(other.size)
+    {
+        other.move_to(storage, other.storage);
+        other.move_to = nullptr;
+    }
+
+    /// @brief Move-construct the event at `destination`, or only destroy it if that is nullptr
+    void (*move_to)(void* destination, void* source);
+    u32 size;
+    alignas(EVENT_ALIGNMENT) u8 storage[MAX_EVENT_SIZE];
+private:
+    template <typename EVENT>
+    static void _move_to(void* destination, void* source) {
+        EVENT* event = std::launder(static_cast<EVENT*>(source));
+        if (destination) {
+            new (destination) EVENT(std::move(*event));
+        }
+        event->~EVENT();
     }
 };
 
+/// @brief Events posted by one thread other than the polling thread. They go into a lock-free queue until it
+/// fills; after that they spill into a locked list until the next poll drains it, so posting never waits for
+/// the polling thread. The shared producer, used by threads beyond MAX_EVENT_PRODUCERS, only uses the list.
+struct EventProducer {
+    /// @brief Who may use a producer slot
+    enum State : u32 {
+        ACTIVE,     // a thread posts into it
+        RETIRED,    // its thread exited; free once the polling thread has drained it
+        FREE,       // drained, waiting for a thread to claim it
+        ORPHANED,   // its handler was destroyed first; deleted by its thread on exit
+    };
+
+    explicit EventProducer(bool shared = false);
+    ~EventProducer();
+
+    /// @brief Pass every queued and spilled event to `fn`, oldest first. Polling thread only
+    template <typename FN>
+    void drain(FN&& fn) {
+        events.consume_all(fn);
+        if (spilling.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> guard(spill_lock);
+            // Events queued before the first spill come first
+            events.consume_all(fn);
+            for (QueuedEvent& queued : spill) {
+                fn(queued);
+            }
+            spill.clear();
+            spilling.store(shared, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Hand the slot back. Called by the owning thread when it exits
+    void retire();
+
+    containers::SpscRingQueue<QueuedEvent> events;
+    std::mutex spill_lock;
+    containers::DArray<QueuedEvent> spill { memory::tag::ENGINE };   // guarded by spill_lock
+    std::atomic<bool> spilling;   // `spill` has events, so later posts must queue behind them
+    std::atomic<u32> state { ACTIVE };
+    const bool shared;
+};
+
 class EventHandler {
 public:
-    EventHandler() 
-        : _callbacks()
-        , _events()
-    {}
+    EventHandler();
+    ~EventHandler();
 
     void register_callback(
         const platform::Window* window,
         EventType type,
         EventCallback callback,
-        const std::string& handler_name,
-        EventPriority priority = EventPriority::NORMAL
+        std::string_view handler_name,
+        EventPriority priority = EventPriority::NORMAL,
+        bool async = false
     ); 
-    void post_event(std::unique_ptr<Event> event, bool immediate=false);
+    /// @brief Post an event. Queued events are copied into the event buffer and handled by the next poll_events().
+    /// Immediate events skip the queue and the priority sort and are handled before this returns. An immediate
+    /// event posted from inside a callback waits until that callback's event has finished dispatching,
+    /// so callbacks never run nested inside one another.
+    /// Any thread may post without waiting. Other threads push into a producer of their own, which poll_events()
+    /// merges after the polling thread's events, so `immediate` only applies on the polling thread.
+    /// @param event The event
+    /// @param immediate Whether this should execute immediately
+    template <typename E>
+    void post_event(E&& event, bool immediate=false) {
+        using EVENT = std::decay_t<E>;
+        static_assert(std::is_base_of_v<Event, EVENT>, "Posted events must derive from Event");
+        static_assert(sizeof(EVENT) <= MAX_EVENT_SIZE, "Event is larger than MAX_EVENT_SIZE");
+        static_assert(alignof(EVENT) <= EVENT_ALIGNMENT, "Event is aligned more strictly than EVENT_ALIGNMENT");
+
+        if (std::this_thread::get_id() != _polling_thread) {
+            EventProducer* producer = _thread_producer();
+            if (producer->spilling.load(std::memory_order_relaxed)
+                || !producer->events.try_emplace(std::in_place_type<EVENT>, std::forward<E>(event))) {
+                // Full until the next poll_events(), which may be waiting on this thread: spill instead of waiting
+                std::lock_guard<std::mutex> guard(producer->spill_lock);
+                producer->spill.emplace_back(std::in_place_type<EVENT>, std::forward<E>(event));
+                producer->spilling.store(true, std::memory_order_relaxed);
+            }
+        } else if (!immediate) {
+            new (_buffers[_write_buffer].allocate(sizeof(EVENT))) EVENT(std::forward<E>(event));
+        } else {
+            // Kept until the next poll_events() so async callbacks can still read it
+            Event* ev = new (_immediate_events.allocate(sizeof(EVENT))) EVENT(std::forward<E>(event));
+            if (_dispatching) {
+                _pending_immediate.push_back(ev);
+            } else {
+                _dispatch_immediate(*ev);
+            }
+        }
+    }
     void poll_events();
     
     static bool startup();
@@ -117,15 +381,27 @@ public:
     static void shutdown();
 
 private:
-    std::unordered_map<
-        const platform::Window*,
-        std::unordered_map< EventType, std::vector<CallbackData> >
-    > _callbacks;
-    std::queue<std::unique_ptr<Event>> _events;
+    DispatchList _dispatch[EVENT_TYPES];    // indexed by EventType
+    EventBuffer _buffers[2];     // posted to while the other is being polled
+    u32 _write_buffer { 0 };
+    EventBuffer _immediate_events { IMMEDIATE_EVENT_BUFFER_SIZE };
+    containers::DArray<Event*, 8> _pending_immediate;    // immediate events posted during dispatch
+    bool _dispatching { false };
+    std::thread::id _polling_thread { std::this_thread::get_id() };
+    std::atomic<EventProducer*> _producers[MAX_EVENT_PRODUCERS] {};   // in the order threads first posted
+    std::atomic<u32> _producer_count { 0 };
+    EventProducer _shared_producer { true };   // for threads that find every producer slot taken
+    u32 _id;    // tells handler instances apart in each thread's cached producer
+    std::unique_ptr<AsyncDispatcher> _async;    // started by the first async callback. Declared last so it stops first
     bool is_initialized { false };
 
+    EventProducer* _thread_producer();
+    void _merge_producers(EventBuffer& events);
+    void _dispatch_immediate(Event& ev);
+    void _dispatch_async(EventCallback callback, Event& ev);
+    void _drain_immediate_events();
     void _process_event(Event& ev);
-    void _process_window_event(Event& ev, const platform::Window* window); 
+    void _process_window_event(Event& ev, const DispatchList& list, const platform::Window* window);
 
     static EventHandler* instance;
 };
@@ -3,6 +3,8 @@
 #include "keys.h"
 #include "mouse_buttons.h"
 #include "events/events.h"
+#include "containers/hash_map.h"
+#include "containers/bit_set.h"
 #include <tuple>
 #include "logger.h"
 
@@ -15,9 +17,14 @@ namespace platform {
 
 namespace core {
 
+/// @brief One bit per key
+using KeySet = containers::BitSet<Keys::KEYS_MAX_KEY>;
+/// @brief One bit per mouse button
+using ButtonSet = containers::BitSet<MouseButtons::MAX_BUTTONS>;
+
 // State of the keys for the keyboard
 struct KeyboardState {
-    bool keys[Keys::KEYS_MAX_KEY] = { false };
+    KeySet keys;   // keys held down
 };
 
 // State of the mouse
@@ -26,16 +33,25 @@ struct MouseState {
         y = 0.f,
         x_prev = 0.f,
         y_prev = 0.f;
-    bool buttons[MouseButtons::MAX_BUTTONS] = { false };
+    ButtonSet buttons;   // buttons held down
     f32 x_scroll = 0,
         y_scroll = 0;
 };
 
+/// @brief Keys and buttons that went down or up between the last two updates
+struct InputEdges {
+    KeySet keys_pressed;
+    KeySet keys_released;
+    ButtonSet buttons_pressed;
+    ButtonSet buttons_released;
+};
+
 struct WindowInputState {
     KeyboardState keyboard_curr_state;
     KeyboardState keyboard_prev_state;
     MouseState mouse_curr_state;
     MouseState mouse_prev_state;
+    InputEdges edges;
     
     bool in_focus { false };
 
@@ -52,6 +68,7 @@ struct InputState {
     KeyboardState keyboard_prev_state;
     MouseState mouse_curr_state;
     MouseState mouse_prev_state;
+    InputEdges edges;
 };
 
 // TODO: Input Handler
@@ -71,23 +88,38 @@ public:
     void process_window_resize(u32 width, u32 height);
     void register_window(platform::Window* wnd);
     void set_focused_window(platform::Window* wnd);
+
+    /// @brief Keys held down in the focused window
+    const KeySet& keys_down() const { return m_state.keyboard_curr_state.keys; }
+    /// @brief Keys that went down between the last two calls to update()
+    const KeySet& keys_pressed() const { return m_state.edges.keys_pressed; }
+    /// @brief Keys that went up between the last two calls to update()
+    const KeySet& keys_released() const { return m_state.edges.keys_released; }
+
+    const ButtonSet& buttons_down() const { return m_state.mouse_curr_state.buttons; }
+    const ButtonSet& buttons_pressed() const { return m_state.edges.buttons_pressed; }
+    const ButtonSet& buttons_released() const { return m_state.edges.buttons_released; }
+
+    /// @brief Input state of a single window
+    /// @return The state. nullptr if the window is not registered
+    const WindowInputState* window_state(platform::Window* wnd) const;
 private:
-    bool _is_button_down(MouseButtons button);
-    bool _is_button_up(MouseButtons button);
-    bool _was_button_down(MouseButtons button);
-    bool _was_button_up(MouseButtons button);
+    bool _is_button_down(MouseButtons button) const { return m_state.mouse_curr_state.buttons.test(button); }
+    bool _is_button_up(MouseButtons button) const { return !m_state.mouse_curr_state.buttons.test(button); }
+    bool _was_button_down(MouseButtons button) const { return m_state.mouse_prev_state.buttons.test(button); }
+    bool _was_button_up(MouseButtons button) const { return !m_state.mouse_prev_state.buttons.test(button); }
     
-    bool _is_key_down(Keys key);
-    bool _is_key_up(Keys key);
-    bool _was_key_down(Keys key);
-    bool _was_key_up(Keys key);
+    bool _is_key_down(Keys key) const { return m_state.keyboard_curr_state.keys.test(key); }
+    bool _is_key_up(Keys key) const { return !m_state.keyboard_curr_state.keys.test(key); }
+    bool _was_key_down(Keys key) const { return m_state.keyboard_prev_state.keys.test(key); }
+    bool _was_key_up(Keys key) const { return !m_state.keyboard_prev_state.keys.test(key); }
 
     InputState m_state;
     static InputHandler* handler_instance;
 protected:
     InputHandler();
 
-    std::unordered_map<platform::Window*, WindowInputState> _window_states;
+    containers::HashMap<platform::Window*, WindowInputState> _window_states;
     /// @brief Window that is currently in focus
     platform::Window* _focused_window { nullptr };
 
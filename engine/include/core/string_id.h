@@ -0,0 +1,75 @@
+#pragma once
+#include "core/defines.h"
+#include "core/types.h"
+#include "containers/hash_map.h"
+
+#include <string_view>
+
+namespace gravity {
+namespace core {
+
+constexpr u64 FNV1A_64_OFFSET = 0xcbf29ce484222325ull;
+constexpr u64 FNV1A_64_PRIME = 0x100000001b3ull;
+constexpr u32 FNV1A_32_OFFSET = 0x811c9dc5u;
+constexpr u32 FNV1A_32_PRIME = 0x01000193u;
+
+/// @brief 64-bit FNV-1a hash of a string. Usable at compile time
+constexpr u64 fnv1a_64(std::string_view str) {
+    u64 hash = FNV1A_64_OFFSET;
+    for (char c : str) {
+        hash = (hash ^ static_cast<u8>(c)) * FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+/// @brief 32-bit FNV-1a hash of a string. Usable at compile time
+constexpr u32 fnv1a_32(std::string_view str) {
+    u32 hash = FNV1A_32_OFFSET;
+    for (char c : str) {
+        hash = (hash ^ static_cast<u8>(c)) * FNV1A_32_PRIME;
+    }
+    return hash;
+}
+
+/// @brief A string reduced to its 64-bit FNV-1a hash, so comparing and looking
+/// up names is an integer operation. Literals hash at compile time with the
+/// _sid suffix; runtime strings go through intern(), which also keeps one
+/// shared copy of the text so str() can give it back for logging.
+class StringId {
+public:
+    constexpr StringId() = default;
+    constexpr explicit StringId(std::string_view str) : _value(fnv1a_64(str)) {}
+
+    /// @brief Id of `str`, storing the text in the intern table if it is not there yet
+    static StringId intern(std::string_view str);
+
+    /// @brief Interned text of the id. Empty if the string was never interned
+    std::string_view str() const;
+
+    constexpr u64 value() const { return _value; }
+    constexpr bool valid() const { return _value != 0; }
+
+    constexpr bool operator==(const StringId& other) const { return _value == other._value; }
+    constexpr bool operator!=(const StringId& other) const { return _value != other._value; }
+    constexpr bool operator<(const StringId& other) const { return _value < other._value; }
+private:
+    u64 _value { 0 };
+};
+
+namespace literals {
+/// @brief Compile time StringId of a literal, e.g. "application"_sid
+consteval StringId operator""_sid(const char* str, usize length) {
+    return StringId(std::string_view(str, length));
+}
+} // literals namespace
+
+} // core namespace
+
+namespace containers {
+/// @brief StringIds are already hashes; only mix them so the table's control bits are well spread
+template <>
+struct Hash<core::StringId> {
+    u64 operator()(const core::StringId& id) const { return hash_mix(id.value()); }
+};
+} // containers namespace
+} // gravity namespace
@@ -0,0 +1,59 @@
+#pragma once
+#include "memory/memory.h"
+
+#include <atomic>
+
+namespace gravity {
+namespace memory {
+
+/// @brief Operations stored in an allocation trace
+enum class TraceOp : u8 {
+    ALLOCATE = 0,
+    FREE = 1,
+    FRAME = 2,   // MemorySystem::begin_frame() was called
+};
+
+/// @brief A single decoded trace record
+struct TraceRecord {
+    TraceOp op;
+    tag memory_tag;
+    u16 thread;        // memory::thread_index() of the recording thread
+    usize size;
+    usize alignment;
+    u64 address;       // identifies the block so frees can be matched to allocations
+    u64 timestamp_ns;  // nanoseconds since recording started
+};
+
+/// @brief Records every memory::allocate/free and frame boundary to a compact
+/// binary file so real workloads can be replayed offline (see tools/alloc_replay).
+///
+/// Each thread appends varint encoded records to its own buffer and only takes the
+/// file lock to write a full buffer out as a chunk, so recording does not serialise
+/// allocating threads. When recording is off the cost is one relaxed atomic load.
+class AllocationTrace {
+public:
+    /// @brief Start recording to a file, replacing it if it exists
+    /// @param path Path of the trace file
+    /// @return true if successful false otherwise
+    static bool start(const char* path);
+
+    /// @brief Flush every thread's buffer and close the file. Other threads must
+    /// not be allocating while this runs
+    static void stop();
+
+    static bool recording() { return _recording.load(std::memory_order_relaxed); }
+
+    /// @brief Append a record for the calling thread. Only call while recording()
+    static void record(TraceOp op, const void* block, usize size, usize alignment, tag memory_tag);
+
+    /// @brief Read every record of a trace file, ordered by timestamp
+    /// @param path Path of the trace file
+    /// @param out Called once per record
+    /// @return true if the file was a valid trace
+    static bool read(const char* path, void (*out)(const TraceRecord& record, void* user), void* user);
+private:
+    inline static std::atomic<bool> _recording { false };
+};
+
+} // memory namespace
+} // gravity namespace
@@ -0,0 +1,74 @@
+#pragma once
+#include "memory/memory.h"
+
+namespace gravity {
+namespace memory {
+
+/// @brief Heap activity through the global operator new/delete during one frame
+struct FrameAllocationStats {
+    u64 frame { 0 };
+    u64 allocations { 0 };
+    u64 frees { 0 };
+    usize bytes_allocated { 0 };
+    usize bytes_freed { 0 };
+    u64 tag_allocations[tag::MAX_TAGS] {};
+    usize tag_bytes[tag::MAX_TAGS] {};         // bytes allocated under each tag
+    u64 tag_frees[tag::MAX_TAGS] {};           // frees of blocks allocated under each tag
+    usize tag_bytes_freed[tag::MAX_TAGS] {};
+};
+
+/// @brief What to do when a frame or scope that must not allocate does
+enum class AllocationFreeMode {
+    OFF,     // do not check
+    LOG,     // log an error with the offending counts
+    ASSERT,  // log and abort
+};
+
+/// @brief Attributes global operator new calls on this thread to a tag until destroyed
+class TagScope {
+public:
+    explicit TagScope(tag memory_tag);
+    ~TagScope();
+private:
+    tag _previous;
+
+    TagScope(const TagScope&) = delete;
+    TagScope& operator=(const TagScope&) = delete;
+};
+
+/// @brief Instrumentation over the global operator new/delete.
+/// Only active when the engine is built with GRAVITY_TRACK_ALLOCATIONS
+/// (`scons track_allocations=1`); otherwise every call is a no-op and no
+/// operators are replaced.
+class AllocationTracker {
+public:
+    /// @brief Whether the global operators are hooked in this build
+    static bool enabled();
+
+    /// @brief Close the current frame: publish its stats, run the allocation-free
+    /// check and start counting the next one. Called from MemorySystem::begin_frame()
+    static void next_frame();
+
+    /// @brief Stats for the last completed frame
+    static const FrameAllocationStats& last_frame();
+
+    /// @brief Check every following frame for heap allocations
+    static void expect_allocation_free_frames(AllocationFreeMode mode);
+};
+
+/// @brief Checks that the calling thread does not touch the heap between construction and destruction
+class AllocationFreeScope {
+public:
+    AllocationFreeScope(const char* name, AllocationFreeMode mode = AllocationFreeMode::ASSERT);
+    ~AllocationFreeScope();
+private:
+    const char* _name;
+    AllocationFreeMode _mode;
+    u64 _start_allocations;
+
+    AllocationFreeScope(const AllocationFreeScope&) = delete;
+    AllocationFreeScope& operator=(const AllocationFreeScope&) = delete;
+};
+
+} // memory namespace
+} // gravity namespace
@@ -0,0 +1,185 @@
+#pragma once
+#include "memory/memory.h"
+
+#include <atomic>
+
+namespace gravity {
+namespace memory {
+
+/// @brief Number of threads that get a private block cache in a ConcurrentPool.
+/// Threads with a higher memory::thread_index(), exiting ones included, go straight to the shared free list.
+constexpr u32 CONCURRENT_POOL_MAX_THREADS = 64;
+
+/// @brief Number of blocks a thread can hold in its private cache
+constexpr u32 CONCURRENT_POOL_MAGAZINE_SIZE = 32;
+
+/// @brief Thread-safe fixed block allocator.
+/// Blocks live on a lock-free free list whose head carries a version counter so
+/// that a pop racing with a pop/push pair cannot corrupt the list (ABA). Each thread
+/// keeps a small magazine of blocks and only touches the shared list to refill or
+/// flush half a magazine at a time. Because of the caching, allocate() can return
+/// nullptr while other threads still hold up to a magazine of free blocks each.
+/// Blocks are aligned to ALIGNMENT; pass CACHE_LINE_SIZE for blocks handed to different threads.
+template <usize BLOCKSIZE, usize NBLOCKS, usize ALIGNMENT = alignof(std::max_align_t)>
+class ConcurrentPool {
+    static_assert(NBLOCKS > 0 && NBLOCKS < 0xFFFFFFFFull, "ConcurrentPool indexes blocks with 32 bits");
+    static_assert(ALIGNMENT > 0 && (ALIGNMENT & (ALIGNMENT - 1)) == 0, "ConcurrentPool alignment must be a power of two");
+public:
+    explicit ConcurrentPool(tag memory_tag = tag::UNKNOWN)
+        : _tag(memory_tag)
+    {
+        _block_size = (BLOCKSIZE + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
+        _memory = static_cast<u8*>(::operator new(_block_size * NBLOCKS, std::align_val_t(ALIGNMENT)));
+        _next = new std::atomic<u32>[NBLOCKS];
+        _magazines = new Magazine[CONCURRENT_POOL_MAX_THREADS];
+
+        for (u32 i = 0; i < NBLOCKS; i++) {
+            _next[i].store(i + 1 < NBLOCKS ? i + 1 : NIL, std::memory_order_relaxed);
+        }
+        _head.store(_pack(0, 0), std::memory_order_release);
+
+        MemorySystem::incr_tag(_tag, _block_size * NBLOCKS);
+    }
+
+    ~ConcurrentPool() {
+        delete[] _magazines;
+        delete[] _next;
+        ::operator delete(_memory, std::align_val_t(ALIGNMENT));
+        MemorySystem::decr_tag(_tag, _block_size * NBLOCKS);
+    }
+
+    /// @brief Allocate a block. Safe to call from any thread
+    /// @return Pointer to the block. nullptr if every block is in use
+    void* allocate() {
+        u32 thread = thread_index();
+        if (thread >= CONCURRENT_POOL_MAX_THREADS) {
+            u32 index = _pop_shared();
+            return index == NIL ? nullptr : _block(index);
+        }
+
+        Magazine& mag = _magazines[thread];
+        if (mag.count == 0) {
+            mag.count = _pop_shared_batch(mag.blocks, CONCURRENT_POOL_MAGAZINE_SIZE / 2);
+            if (mag.count == 0) {
+                return nullptr;
+            }
+        }
+
+        return _block(mag.blocks[--mag.count]);
+    }
+
+    /// @brief Return a block to the pool. Safe to call from any thread, including
+    /// one that did not allocate the block
+    /// @param ptr Block to return
+    void deallocate(void* ptr) {
+        if (!ptr) return;
+
+        assert(ptr >= _memory && ptr < (_memory + (_block_size * NBLOCKS)));
+        u32 index = static_cast<u32>((static_cast<u8*>(ptr) - _memory) / _block_size);
+
+        u32 thread = thread_index();
+        if (thread >= CONCURRENT_POOL_MAX_THREADS) {
+            _push_shared(&index, 1);
+            return;
+        }
+
+        Magazine& mag = _magazines[thread];
+        if (mag.count == CONCURRENT_POOL_MAGAZINE_SIZE) {
+            constexpr u32 half = CONCURRENT_POOL_MAGAZINE_SIZE / 2;
+            _push_shared(mag.blocks + half, half);
+            mag.count = half;
+        }
+        mag.blocks[mag.count++] = index;
+    }
+
+    usize block_size() const { return _block_size; }
+    usize block_alignment() const { return ALIGNMENT; }
+    usize block_count() const { return NBLOCKS; }
+
+    /// @brief Blocks on the shared free list. Blocks cached by threads are not counted
+    usize blocks_available() const { return _shared_available.load(std::memory_order_relaxed); }
+private:
+    static constexpr u32 NIL = 0xFFFFFFFF;
+
+    /// @brief Per-thread block cache. Only ever touched by the thread that owns the index
+    struct alignas(CACHE_LINE_SIZE) Magazine {
+        u32 count { 0 };
+        u32 blocks[CONCURRENT_POOL_MAGAZINE_SIZE];
+    };
+
+    // Free list head: low 32 bits are the first free block, high 32 bits a version
+    // that every push and pop increments.
+    static u64 _pack(u32 index, u32 version) { return (static_cast<u64>(version) << 32) | index; }
+    static u32 _index(u64 head) { return static_cast<u32>(head); }
+    static u32 _version(u64 head) { return static_cast<u32>(head >> 32); }
+
+    void* _block(u32 index) const { return _memory + (static_cast<usize>(index) * _block_size); }
+
+    /// @brief Pop a single block off the shared list
+    u32 _pop_shared() {
+        u32 index;
+        return _pop_shared_batch(&index, 1) ? index : NIL;
+    }
+
+    /// @brief Pop up to `max` blocks off the shared list with a single CAS.
+    /// The version makes this safe: if the CAS succeeds nothing was pushed or popped
+    /// since `head` was read, so the chain walked below is still the list.
+    u32 _pop_shared_batch(u32* out, u32 max) {
+        u64 head = _head.load(std::memory_order_acquire);
+        while (true) {
+            u32 count = 0;
+            u32 index = _index(head);
+            while (index != NIL && count < max) {
+                out[count++] = index;
+                index = _next[index].load(std::memory_order_relaxed);
+            }
+
+            if (count == 0) {
+                return 0;
+            }
+
+            if (_head.compare_exchange_weak(
+                head, _pack(index, _version(head) + 1),
+                std::memory_order_acquire,
+                std::memory_order_acquire
+            )) {
+                _shared_available.fetch_sub(count, std::memory_order_relaxed);
+                return count;
+            }
+        }
+    }
+
+    /// @brief Link `count` blocks into a chain and push it onto the shared list with a single CAS
+    void _push_shared(const u32* blocks, u32 count) {
+        for (u32 i = 0; i + 1 < count; i++) {
+            _next[blocks[i]].store(blocks[i + 1], std::memory_order_relaxed);
+        }
+
+        u32 last = blocks[count - 1];
+        u64 head = _head.load(std::memory_order_relaxed);
+        do {
+            _next[last].store(_index(head), std::memory_order_relaxed);
+        } while (!_head.compare_exchange_weak(
+            head, _pack(blocks[0], _version(head) + 1),
+            std::memory_order_release,
+            std::memory_order_relaxed
+        ));
+
+        _shared_available.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    alignas(CACHE_LINE_SIZE) std::atomic<u64> _head { 0 };             // versioned head of the shared free list
+    alignas(CACHE_LINE_SIZE) std::atomic<usize> _shared_available { NBLOCKS };
+
+    usize _block_size;           // size in bytes for each block
+    tag _tag;                    // tag the backing memory is accounted to
+    u8* _memory;                 // where we allocate blocks to
+    std::atomic<u32>* _next;     // free list links, kept out of the blocks so user writes never race with a pop
+    Magazine* _magazines;        // per-thread caches indexed by memory::thread_index()
+
+    ConcurrentPool(const ConcurrentPool&) = delete;
+    ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+};
+
+} // memory namespace
+} // gravity namespace
@@ -2,6 +2,13 @@
 #include "core/defines.h"
 #include "core/types.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
 namespace gravity {
 
 namespace memory {
@@ -44,91 +51,513 @@ enum tag {
     AUDIO,
     REGISTRY,
     PLUGIN,
+    STACK_ALLOCATOR,
+
+    MAX_TAGS,
+
+    // Not accounted. Used for allocator backing memory whose contents are
+    // accounted per allocation, so it would otherwise be counted twice.
+    UNTRACKED = MAX_TAGS
+};
+
+/// @brief Size in bytes of a cache line on the platforms we target
+constexpr usize CACHE_LINE_SIZE = 64;
+
+/// @brief Size in bytes of the per-frame arena owned by the memory subsystem
+constexpr usize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+
+/// @brief Size in bytes of each thread's scratch stack
+constexpr usize THREAD_STACK_SIZE = 1024 * 1024;
+
+/// @brief Bump-pointer allocator over a single fixed block of memory.
+/// Individual allocations are never freed; everything is released at once with reset().
+class LinearAllocator {
+public:
+    explicit LinearAllocator(usize total_size, tag memory_tag = tag::LINEAR_ALLOCATOR);
+    ~LinearAllocator();
+
+    /// @brief Allocate a block from the allocator
+    /// @param size Size in bytes of the block
+    /// @param alignment Alignment of the block. Must be a power of two
+    /// @return Pointer to the block. nullptr if the allocator is out of space
+    void* allocate(usize size, usize alignment = alignof(std::max_align_t)) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(_memory);
+        uintptr_t aligned = (base + _allocated + (alignment - 1)) & ~(alignment - 1);
+        usize end = (aligned - base) + size;
+        if (end > _total_size) {
+            return _out_of_memory(size);
+        }
+
+        _allocated = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /// @brief Release every allocation made since the last reset
+    void reset();
+
+    usize total_size() const { return _total_size; }
+    usize allocated() const { return _allocated; }
+    usize high_water() const { return std::max(_high_water, _allocated); }
+private:
+    void* _out_of_memory(usize size);
+
+    usize _total_size;  // size in bytes of the backing block
+    usize _allocated;   // offset of the next free byte
+    usize _high_water;  // largest value _allocated reached before a reset
+    tag _tag;           // tag the backing block is accounted to
+    u8* _memory;        // backing block
 
-    MAX_TAGS
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
 };
 
+/// @brief Bump-pointer allocator that is rolled back to markers.
+/// push() remembers the top of the stack and pop() releases everything allocated
+/// since, so nested scopes can each take scratch memory and give it back on exit.
+/// Markers must be popped in reverse order of push; debug builds check this.
+class StackAllocator {
+public:
+    /// @brief Top of the stack at the time of a push()
+    struct Marker {
+        usize offset;
+#if defined(Q_DEBUG)
+        u32 depth;   // markers already pushed when this one was
+#endif
+    };
+
+    explicit StackAllocator(usize total_size, tag memory_tag = tag::STACK_ALLOCATOR);
+    ~StackAllocator();
+
+    /// @brief Allocate a block on top of the stack
+    /// @param size Size in bytes of the block
+    /// @param alignment Alignment of the block. Must be a power of two
+    /// @return Pointer to the block. nullptr if the stack is out of space
+    void* allocate(usize size, usize alignment = alignof(std::max_align_t)) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(_memory);
+        uintptr_t aligned = (base + _allocated + (alignment - 1)) & ~(alignment - 1);
+        usize end = (aligned - base) + size;
+        if (end > _total_size) {
+            return _out_of_memory(size);
+        }
+
+        _allocated = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /// @brief Remember the current top of the stack
+    Marker push() {
+#if defined(Q_DEBUG)
+        return { _allocated, _depth++ };
+#else
+        return { _allocated };
+#endif
+    }
+
+    /// @brief Release every allocation made since `marker` was pushed
+    /// @param marker Most recently pushed marker that has not been popped
+    void pop(Marker marker) {
+#if defined(Q_DEBUG)
+        _validate_pop(marker);
+#endif
+        _high_water = std::max(_high_water, _allocated);
+        _allocated = std::min(marker.offset, _allocated);
+    }
+
+    usize total_size() const { return _total_size; }
+    usize allocated() const { return _allocated; }
+    usize high_water() const { return std::max(_high_water, _allocated); }
+private:
+    void* _out_of_memory(usize size);
+#if defined(Q_DEBUG)
+    void _validate_pop(const Marker& marker);
+
+    u32 _depth { 0 };   // markers pushed and not yet popped
+#endif
+
+    usize _total_size;  // size in bytes of the backing block
+    usize _allocated;   // offset of the next free byte
+    usize _high_water;  // largest value _allocated reached before a pop
+    tag _tag;           // tag the backing block is accounted to
+    u8* _memory;        // backing block
+
+    StackAllocator(const StackAllocator&) = delete;
+    StackAllocator& operator=(const StackAllocator&) = delete;
+};
+
+/// @brief Accounting for a single tag, merged across every thread
+struct TagStats {
+    usize current { 0 };     // bytes currently allocated
+    usize peak { 0 };        // highest value `current` has reached. Threads batch up to 64 KiB per tag before
+                             // publishing, so this can miss up to that much per thread; exact for hard-limited tags
+    u64 allocations { 0 };   // number of incr_tag calls
+    u64 frees { 0 };         // number of decr_tag calls
+};
+
+/// @brief Byte limits for a single tag. 0 means unlimited
+struct TagBudget {
+    usize soft { 0 };   // callbacks are told once per frame while the tag is above this
+    usize hard { 0 };   // allocations that would go above this fail after the callbacks had a chance to free memory
+};
+
+/// @brief Which limit of a budget was crossed
+enum class BudgetLimit {
+    SOFT,
+    HARD,
+};
+
+/// @brief Called when a tag goes over its budget. Hard limit callbacks run on the
+/// allocating thread, so they must be thread-safe; they may free memory of the tag
+/// @param memory_tag Tag that is over budget
+/// @param limit Limit that was crossed
+/// @param current Bytes accounted to the tag, including the request for hard limits
+/// @param budget Value of the limit
+/// @param user Pointer given at registration
+using BudgetCallback = void (*)(tag memory_tag, BudgetLimit limit, usize current, usize budget, void* user);
+
+/// @brief Most callbacks that can be registered with MemorySystem::add_budget_callback()
+constexpr usize MAX_BUDGET_CALLBACKS = 16;
+
+/// @brief Get a printable name for a tag
+const char* tag_name(tag memory_tag);
+
+/// @brief Returned by thread_index() once the calling thread has handed its index back on exit
+constexpr u32 EXITING_THREAD_INDEX = 0xFFFFFFFF;
+
+/// @brief Dense, reusable index of the calling thread. Used to give threads private caches
+u32 thread_index();
+
+/// @brief Largest request served by the size-classed pools of memory::allocate()
+constexpr usize SMALL_ALLOCATION_MAX = 1024;
+
+/// @brief Allocate a block of memory and account it to a tag
+void* allocate(usize size, usize alignment, tag memory_tag);
+
+/// @brief Free a block returned by allocate(). Size, alignment and tag must match the allocation
+void free(void* block, usize size, usize alignment, tag memory_tag);
+
+/// @brief Reserve and commit pages straight from the OS, aligned to their own size. Used for Pool slabs
+/// @param size Size in bytes of the slab. Must be a power of two
+/// @return Pointer to the slab. nullptr if out of memory
+void* allocate_slab(usize size);
+
+/// @brief Return a slab from allocate_slab() to the OS
+void free_slab(void* slab, usize size);
+
 class MemorySystem {
 public:
     static bool startup();
     static bool shutdown();
     static void incr_tag(tag memory_tag, usize amt);
     static void decr_tag(tag memory_tag, usize amt);
+    static TagStats tag_stats(tag memory_tag);
+    static void collect_stats(TagStats (&stats)[tag::MAX_TAGS]);
     static void dump_info();
+
+    /// @brief Set the byte limits of a tag. Does not need the memory system to be started
+    static void set_budget(tag memory_tag, usize soft, usize hard);
+    static TagBudget budget(tag memory_tag);
+
+    /// @brief Register a function to call when a tag goes over budget
+    /// @return true if successful false if MAX_BUDGET_CALLBACKS are already registered
+    static bool add_budget_callback(BudgetCallback callback, void* user = nullptr);
+    static void remove_budget_callback(BudgetCallback callback, void* user = nullptr);
+
+    /// @brief Account `amt` bytes to a tag before allocating them, as incr_tag does, unless that would take
+    /// the tag over its hard limit. Over the limit, budget callbacks are run so they can free memory and the
+    /// reservation is tried again. The bytes are added before the limit is checked, so concurrent callers
+    /// can never take the tag past it together
+    /// @return true if the bytes were accounted. false, with nothing accounted, if they do not fit
+    static bool reserve_tag(tag memory_tag, usize amt);
+    /// @brief Undo a successful reserve_tag() whose allocation then failed
+    static void cancel_reservation(tag memory_tag, usize amt);
+
+    /// @brief Arena for data that only lives until the end of the current frame
+    static LinearAllocator& frame_allocator() { return *get()->_state.frame_allocator; }
+
+    /// @brief std::pmr view of the frame arena, for containers that only live until the end of the frame
+    static std::pmr::memory_resource* frame_resource() { return get()->_state.frame_resource; }
+
+    /// @brief Scratch stack private to the calling thread, created on first use.
+    /// Does not need the memory system to be started
+    static StackAllocator& thread_stack();
+
+    /// @brief Release all frame allocations. Called once per iteration of the application loop
+    static void reset_frame() { get()->_state.frame_allocator->reset(); }
+
+    /// @brief Per-frame bookkeeping: checks soft budgets, closes the allocation tracker's frame, compacts relocatable heaps and resets the frame arena
+    static void begin_frame();
 private:
     struct {
         bool is_initialized { false };
-        usize tag_memory[tag::MAX_TAGS] {};
+        LinearAllocator* frame_allocator { nullptr };
+        std::pmr::memory_resource* frame_resource { nullptr };
     } _state;
 
     static MemorySystem* instance;
     static MemorySystem* get();
 };
 
-template <usize BLOCKSIZE, usize NBLOCKS>
+/// @brief Pushes a marker on a StackAllocator and pops it when destroyed.
+/// Everything allocated through the scope, or from the stack while it is the
+/// innermost scope, is released at scope exit.
+class StackScope {
+public:
+    explicit StackScope(StackAllocator& stack = MemorySystem::thread_stack())
+        : _stack(stack)
+        , _marker(stack.push())
+    {}
+    ~StackScope() { _stack.pop(_marker); }
+
+    /// @brief Allocate a block that lives until the end of the scope
+    void* allocate(usize size, usize alignment = alignof(std::max_align_t)) { return _stack.allocate(size, alignment); }
+
+    StackAllocator& stack() const { return _stack; }
+private:
+    StackAllocator& _stack;
+    StackAllocator::Marker _marker;
+
+    StackScope(const StackScope&) = delete;
+    StackScope& operator=(const StackScope&) = delete;
+};
+
+/// @brief How a Pool behaves once every block it owns is in use
+enum class PoolGrowth {
+    FIXED,            // allocate() returns nullptr once the first slab is full
+    GROW,             // chain a new slab on demand and keep it until the pool is destroyed
+    GROW_AND_RELEASE, // chain a new slab on demand and free slabs that become empty
+};
+
+/// @brief Smallest slab a Pool allocates, so slabs are whole pages
+constexpr usize POOL_MIN_SLAB_SIZE = 4096;
+
+/// @brief Fixed-size block allocator.
+/// Blocks are carved out of slabs of about NBLOCKS blocks. A growable pool
+/// chains more slabs as needed; blocks never move once handed out. Slabs come
+/// straight from the OS, aligned to their own power-of-two size so the owning
+/// slab of a block is found by masking its address.
+/// Every block is aligned to ALIGNMENT, e.g. 32 for AVX data or CACHE_LINE_SIZE
+/// to keep blocks used by different threads off each other's cache lines.
+template <usize BLOCKSIZE, usize NBLOCKS, usize ALIGNMENT = alignof(std::max_align_t)>
 class Pool {
+    static_assert(ALIGNMENT > 0 && (ALIGNMENT & (ALIGNMENT - 1)) == 0, "Pool alignment must be a power of two");
+
+    struct block {
+        block* next;
+    };
+    static constexpr usize BLOCK_ALIGNMENT = std::max(ALIGNMENT, alignof(block));
+
+    struct Slab {
+        const Pool* owner;   // pool the slab belongs to, for validating frees
+        Slab* next_all;      // every slab of the pool
+        Slab* prev_all;
+        Slab* next_partial;  // slabs with at least one free block
+        Slab* prev_partial;
+        block* first_free;   // free list local to this slab
+        usize used;          // blocks currently handed out from this slab
+    };
+
+    static constexpr usize _round_up(usize n, usize a) { return (n + (a - 1)) & ~(a - 1); }
+    static constexpr usize _next_pow2(usize n) {
+        usize p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
 public:
-    Pool() {
-        usize t_block_size = std::max(BLOCKSIZE, sizeof(block*));
-        _block_size = (t_block_size + (alignof(std::max_align_t) - 1)) & ~(alignof(std::max_align_t) - 1);
-        _n_blocks = NBLOCKS;
-        _blocks_available = _n_blocks;
-
-        _memory = new u8[_block_size * _n_blocks];
-        _first_free = reinterpret_cast<block*>(_memory);
-
-        block* curr = _first_free;
-        for (usize i = 0; i < _n_blocks; i++) {
-            block* next = reinterpret_cast<block*>(reinterpret_cast<u8*>(curr) + _block_size);
-            curr->next = next;
-            curr = next;
-        }
+    static constexpr usize BLOCK_SIZE = _round_up(std::max(BLOCKSIZE, sizeof(block)), BLOCK_ALIGNMENT);
+    static constexpr usize SLAB_HEADER_SIZE = _round_up(sizeof(Slab), BLOCK_ALIGNMENT);
+    // The header shares the power of two with the blocks, so a slab may hold one block less than
+    // NBLOCKS rather than doubling in size. Rounding up leaves room for extra blocks otherwise
+    static constexpr usize SLAB_SIZE = std::max(
+        _next_pow2(std::max(BLOCK_SIZE * NBLOCKS, SLAB_HEADER_SIZE + BLOCK_SIZE)),
+        POOL_MIN_SLAB_SIZE
+    );
+    static constexpr usize BLOCKS_PER_SLAB = (SLAB_SIZE - SLAB_HEADER_SIZE) / BLOCK_SIZE;
 
-        curr->next = nullptr;
+    /// @brief Create a pool with a single slab. Throws std::bad_alloc if the slab cannot be allocated
+    /// @param memory_tag Tag the slabs are accounted to
+    /// @param growth What to do when every block is in use
+    explicit Pool(tag memory_tag = tag::UNKNOWN, PoolGrowth growth = PoolGrowth::FIXED)
+        : _tag(memory_tag)
+        , _growth(growth)
+    {
+        MemorySystem::incr_tag(_tag, SLAB_SIZE);
+        if (!_add_slab()) {
+            MemorySystem::decr_tag(_tag, SLAB_SIZE);
+            throw std::bad_alloc();
+        }
     }
-    
+
     ~Pool() {
-        delete[] _memory;
+        Slab* slab = _all_slabs;
+        while (slab) {
+            Slab* next = slab->next_all;
+            _free_slab(slab);
+            slab = next;
+        }
     }
 
-    void* allocate(tag memory_tag) {
-        if (!_first_free) {
-            return nullptr;
+    /// @brief Allocate a block
+    /// @return Pointer to the block. nullptr if the pool is FIXED and exhausted, its tag is over its
+    /// hard budget or the OS is out of memory
+    void* allocate() {
+        if (!_partial_slabs) {
+            if (_growth == PoolGrowth::FIXED || !MemorySystem::reserve_tag(_tag, SLAB_SIZE)) {
+                return nullptr;
+            }
+            if (!_add_slab()) {
+                MemorySystem::cancel_reservation(_tag, SLAB_SIZE);
+                return nullptr;
+            }
         }
 
-        block* b = _first_free;
-        _first_free = b->next;
+        Slab* slab = _partial_slabs;
+        if (slab->used == 0) {
+            _empty_slabs -= 1;
+        }
+
+        block* b = slab->first_free;
+        slab->first_free = b->next;
+        slab->used += 1;
         _blocks_available -= 1;
 
+        if (!slab->first_free) {
+            _unlink_partial(slab);
+        }
+
         return b;
     }
 
+    /// @brief Return a block to the pool
+    /// @param ptr Block to return
     void deallocate(void* ptr) {
         if (!ptr) return;
 
-        assert(ptr >= _memory 
-            && (_memory + (_block_sizek * _n_blocks)));
-        
+        Slab* slab = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(ptr) & ~(SLAB_SIZE - 1));
+        assert(slab->owner == this && "Pool::deallocate called with a block from another pool");
+
+        bool was_full = !slab->first_free;
         block* b = static_cast<block*>(ptr);
-        b->next = _first_free;
-        _first_free = b;
+        b->next = slab->first_free;
+        slab->first_free = b;
+        slab->used -= 1;
         _blocks_available += 1;
+
+        if (was_full) {
+            _link_partial(slab);
+        }
+
+        if (slab->used == 0) {
+            // Keep one empty slab around so a pool hovering at a slab boundary
+            // does not allocate and free a slab on every call
+            if (_growth == PoolGrowth::GROW_AND_RELEASE && _empty_slabs > 0) {
+                _release_slab(slab);
+            } else {
+                _empty_slabs += 1;
+            }
+        }
     }
-    
-    usize block_size() const { return _block_size; }
-    usize block_count() const { return _n_blocks; }
+
+    usize block_size() const { return BLOCK_SIZE; }
+    usize block_alignment() const { return BLOCK_ALIGNMENT; }
+    usize block_count() const { return _slab_count * BLOCKS_PER_SLAB; }
     usize blocks_available() const { return _blocks_available; }
+    usize blocks_in_use() const { return block_count() - _blocks_available; }
+    usize slab_count() const { return _slab_count; }
+
+    /// @brief Fraction of blocks that are in use, in [0, 1]
+    f32 occupancy() const {
+        return static_cast<f32>(blocks_in_use()) / static_cast<f32>(block_count());
+    }
 private:
-    struct block {
-        block* next;
-    };
-    
-    usize _block_size;       // size in bytes for each block
-    usize _n_blocks;         // total number of blocks we can allocate
-    usize _blocks_available; // number of currently available blocks
-    block* _first_free;
-    
-    u8* _memory;             // where we allocate blocks to
+    /// @brief Allocate a slab, thread its blocks into a free list and make it the first partial slab.
+    /// The caller has already accounted SLAB_SIZE bytes to the tag
+    /// @return true if successful false if the OS is out of memory
+    bool _add_slab() {
+        u8* memory = static_cast<u8*>(allocate_slab(SLAB_SIZE));
+        if (!memory) {
+            return false;
+        }
+        Slab* slab = reinterpret_cast<Slab*>(memory);
+        slab->owner = this;
+        slab->used = 0;
+        slab->first_free = reinterpret_cast<block*>(memory + SLAB_HEADER_SIZE);
+
+        block* curr = slab->first_free;
+        for (usize i = 0; i + 1 < BLOCKS_PER_SLAB; i++) {
+            block* next = reinterpret_cast<block*>(reinterpret_cast<u8*>(curr) + BLOCK_SIZE);
+            curr->next = next;
+            curr = next;
+        }
+        curr->next = nullptr;
+
+        slab->prev_all = nullptr;
+        slab->next_all = _all_slabs;
+        if (_all_slabs) {
+            _all_slabs->prev_all = slab;
+        }
+        _all_slabs = slab;
+        slab->next_partial = nullptr;
+        slab->prev_partial = nullptr;
+        _link_partial(slab);
+
+        _slab_count += 1;
+        _empty_slabs += 1;
+        _blocks_available += BLOCKS_PER_SLAB;
+        return true;
+    }
+
+    /// @brief Unlink an empty slab from the pool and free it
+    void _release_slab(Slab* slab) {
+        _unlink_partial(slab);
+
+        if (slab->prev_all) {
+            slab->prev_all->next_all = slab->next_all;
+        } else {
+            _all_slabs = slab->next_all;
+        }
+        if (slab->next_all) {
+            slab->next_all->prev_all = slab->prev_all;
+        }
+
+        _slab_count -= 1;
+        _blocks_available -= BLOCKS_PER_SLAB;
+        _free_slab(slab);
+    }
+
+    void _free_slab(Slab* slab) {
+        free_slab(slab, SLAB_SIZE);
+        MemorySystem::decr_tag(_tag, SLAB_SIZE);
+    }
+
+    void _link_partial(Slab* slab) {
+        slab->prev_partial = nullptr;
+        slab->next_partial = _partial_slabs;
+        if (_partial_slabs) {
+            _partial_slabs->prev_partial = slab;
+        }
+        _partial_slabs = slab;
+    }
+
+    void _unlink_partial(Slab* slab) {
+        if (slab->prev_partial) {
+            slab->prev_partial->next_partial = slab->next_partial;
+        } else {
+            _partial_slabs = slab->next_partial;
+        }
+        if (slab->next_partial) {
+            slab->next_partial->prev_partial = slab->prev_partial;
+        }
+        slab->next_partial = nullptr;
+        slab->prev_partial = nullptr;
+    }
+
+    tag _tag;                          // tag the slabs are accounted to
+    PoolGrowth _growth;                // what to do when every block is in use
+    Slab* _all_slabs { nullptr };      // every slab owned by the pool
+    Slab* _partial_slabs { nullptr };  // slabs that still have free blocks
+    usize _slab_count { 0 };           // number of slabs owned by the pool
+    usize _empty_slabs { 0 };          // slabs with no blocks in use
+    usize _blocks_available { 0 };     // number of currently available blocks
 
     Pool(const Pool&) = delete;
     Pool& operator=(const Pool&) = delete;
@@ -0,0 +1,91 @@
+#pragma once
+#include "memory/memory.h"
+
+#include <memory_resource>
+
+namespace gravity {
+namespace memory {
+
+/// @brief std::pmr resource over memory::allocate/free. Every allocation is
+/// accounted to the resource's tag, so pmr containers show up in tag reports.
+class TaggedResource : public std::pmr::memory_resource {
+public:
+    explicit TaggedResource(tag memory_tag) : _tag(memory_tag) {}
+
+    tag memory_tag() const { return _tag; }
+protected:
+    void* do_allocate(usize bytes, usize alignment) override {
+        void* block = memory::allocate(bytes, alignment, _tag);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+
+    void do_deallocate(void* block, usize bytes, usize alignment) override {
+        memory::free(block, bytes, alignment, _tag);
+    }
+
+    // Blocks are interchangeable between tags, but freeing through another
+    // resource would charge the wrong tag
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+private:
+    tag _tag;
+};
+
+/// @brief std::pmr resource over a LinearAllocator. Deallocation is a no-op;
+/// memory comes back when the allocator is reset.
+class LinearAllocatorResource : public std::pmr::memory_resource {
+public:
+    explicit LinearAllocatorResource(LinearAllocator& allocator) : _allocator(allocator) {}
+protected:
+    void* do_allocate(usize bytes, usize alignment) override {
+        void* block = _allocator.allocate(bytes, alignment);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+
+    void do_deallocate(void*, usize, usize) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+private:
+    LinearAllocator& _allocator;
+};
+
+/// @brief std::pmr resource over a StackAllocator. Deallocation is a no-op;
+/// memory comes back when the enclosing marker is popped, so containers using it
+/// must be destroyed before their StackScope.
+class StackAllocatorResource : public std::pmr::memory_resource {
+public:
+    explicit StackAllocatorResource(StackAllocator& allocator) : _allocator(allocator) {}
+protected:
+    void* do_allocate(usize bytes, usize alignment) override {
+        void* block = _allocator.allocate(bytes, alignment);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+
+    void do_deallocate(void*, usize, usize) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+private:
+    StackAllocator& _allocator;
+};
+
+/// @brief Shared resource that allocates through memory::allocate and accounts to `memory_tag`
+/// @param memory_tag Tag to account allocations to
+/// @return Resource that lives for the whole program
+std::pmr::memory_resource* tagged_resource(tag memory_tag);
+
+} // memory namespace
+} // gravity namespace
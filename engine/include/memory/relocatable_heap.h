@@ -0,0 +1,149 @@
+#pragma once
+#include "memory/memory.h"
+#include "memory/virtual_arena.h"
+
+namespace gravity {
+namespace memory {
+
+/// @brief Alignment of every block handed out by a RelocatableHeap
+constexpr usize RELOCATABLE_ALIGNMENT = 16;
+
+/// @brief Default number of bytes a RelocatableHeap moves per frame
+constexpr usize RELOCATABLE_FRAME_BUDGET = 256 * 1024;
+
+/// @brief Reference to a block in a RelocatableHeap. Stays valid when the block
+/// moves; becomes stale, rather than dangling, once the block is freed
+struct RelocatableHandle {
+    static constexpr u32 INVALID_INDEX = ~0u;
+
+    u32 index { INVALID_INDEX };
+    u32 generation { 0 };
+
+    bool valid() const { return index != INVALID_INDEX; }
+};
+
+/// @brief Heap for long lived, variable sized resources that is compacted a
+/// little every frame so its footprint tracks the live data instead of growing
+/// with fragmentation over long sessions.
+///
+/// Blocks are laid out back to back in a VirtualArena and referenced through
+/// generational handles. Freed blocks merge with free neighbours into holes that
+/// are binned by size and reused by later allocations. defragment() slides live
+/// blocks down over the holes until it has moved its byte budget and decommits
+/// whatever is left past the new top.
+/// Pointers from get() are only valid until the next defragment(); pin a block
+/// to keep it in place, e.g. while the GPU reads from it.
+///
+/// Heaps are compacted by MemorySystem::begin_frame(). Not thread-safe.
+class RelocatableHeap {
+public:
+    /// @brief Reserve address space for the heap. Nothing is committed yet
+    /// @param reserve_size Maximum size in bytes the heap can grow to
+    /// @param memory_tag Tag committed memory is accounted to
+    /// @param frame_budget Bytes moved by the compaction in each begin_frame(). 0 to only compact manually
+    RelocatableHeap(usize reserve_size, tag memory_tag, usize frame_budget = RELOCATABLE_FRAME_BUDGET);
+    ~RelocatableHeap();
+
+    /// @brief Allocate a block
+    /// @param size Size in bytes of the block
+    /// @return Handle to the block. Invalid if the reservation is exhausted
+    RelocatableHandle allocate(usize size);
+
+    /// @brief Free a block. Stale or invalid handles are ignored
+    void free(RelocatableHandle handle);
+
+    /// @brief Current address of a block
+    /// @return Pointer valid until the next defragment(). nullptr for stale handles
+    void* get(RelocatableHandle handle) const {
+        const Entry* entry = _entry(handle);
+        return entry ? _base() + entry->offset + HEADER_SIZE : nullptr;
+    }
+
+    /// @brief Usable size in bytes of a block. 0 for stale handles
+    usize size(RelocatableHandle handle) const;
+
+    /// @brief Keep a block from moving until the matching unpin()
+    void pin(RelocatableHandle handle);
+    void unpin(RelocatableHandle handle);
+
+    /// @brief Slide live blocks down over holes
+    /// @param budget Bytes to move before stopping. At least one block is moved if any can be
+    /// @return Bytes moved
+    usize defragment(usize budget);
+
+    /// @brief Run each heap's per-frame compaction. Called from MemorySystem::begin_frame()
+    static void defragment_all();
+
+    usize live_bytes() const { return _live_bytes; }
+    usize used() const { return _top; }
+    usize committed() const { return _blocks.committed(); }
+private:
+    /// @brief In front of every block and hole. Sizes are in RELOCATABLE_ALIGNMENT units
+    struct Header {
+        u32 entry;       // index of the owning entry, HOLE for free space
+        u32 prev_units;  // size of the physically previous block, 0 for the first
+        u64 units;       // size of this block including the header
+    };
+    static constexpr usize HEADER_SIZE = RELOCATABLE_ALIGNMENT;
+    static_assert(sizeof(Header) <= HEADER_SIZE, "RelocatableHeap header must fit in one alignment unit");
+
+    /// @brief Stored after the header of a hole
+    struct HoleLinks {
+        usize next;
+        usize prev;
+    };
+    static constexpr usize MIN_BLOCK_SIZE = HEADER_SIZE + sizeof(HoleLinks);
+    static constexpr u32 HOLE = ~0u;
+    static constexpr usize NO_BLOCK = ~usize(0);
+    static constexpr u32 HOLE_BINS = 48;
+    // Holes of the request's own bin that are checked before moving to larger bins
+    static constexpr u32 HOLE_SEARCH_LIMIT = 8;
+
+    struct Entry {
+        usize offset;     // offset of the block header from the base of the heap
+        u32 generation;   // bumped on free so old handles go stale
+        u32 pins;         // pin count, or the next free entry while unused
+        bool live;
+    };
+
+    u8* _base() const { return _blocks.base(); }
+    Header* _header(usize offset) const { return reinterpret_cast<Header*>(_base() + offset); }
+    HoleLinks* _links(usize offset) const { return reinterpret_cast<HoleLinks*>(_base() + offset + HEADER_SIZE); }
+    Entry* _entries() const { return reinterpret_cast<Entry*>(_table.base()); }
+    const Entry* _entry(RelocatableHandle handle) const {
+        if (handle.index >= _entry_count) return nullptr;
+        const Entry* entry = _entries() + handle.index;
+        return entry->live && entry->generation == handle.generation ? entry : nullptr;
+    }
+    Entry* _entry(RelocatableHandle handle) {
+        return const_cast<Entry*>(static_cast<const RelocatableHeap*>(this)->_entry(handle));
+    }
+
+    static u32 _bin(usize size);
+    void _insert_hole(usize offset, usize size, usize prev_size);
+    void _remove_hole(usize offset);
+    usize _take_hole(usize size);
+    void _trim();
+
+    VirtualArena _blocks;              // block storage, used as a growable buffer from its base
+    VirtualArena _table;               // handle entries
+    usize _top { 0 };                  // end of the last block
+    u32 _last_units { 0 };             // size of the block that ends at _top
+    usize _first_hole { 0 };           // no holes below this offset; compaction starts here
+    usize _live_bytes { 0 };           // bytes of live blocks including headers
+    u64 _bin_bitmap { 0 };             // bins with at least one hole
+    usize _bins[HOLE_BINS];            // first hole of each bin
+    u32 _entry_count { 0 };
+    u32 _free_entry { HOLE };          // head of the unused entry list
+    usize _frame_budget;
+    RelocatableHeap* _next { nullptr };
+    RelocatableHeap* _prev { nullptr };
+
+    static RelocatableHeap* _heaps;    // every heap, for defragment_all()
+
+    RelocatableHeap(const RelocatableHeap&) = delete;
+    RelocatableHeap& operator=(const RelocatableHeap&) = delete;
+};
+
+} // memory namespace
+} // gravity namespace
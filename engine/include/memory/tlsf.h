@@ -0,0 +1,84 @@
+#pragma once
+#include "memory/memory.h"
+
+namespace gravity {
+namespace memory {
+
+/// @brief Default size in bytes of each chunk a Tlsf requests when it runs out of space
+constexpr usize TLSF_DEFAULT_CHUNK_SIZE = 16 * 1024 * 1024;
+
+/// @brief Minimum alignment of every block handed out by a Tlsf
+constexpr usize TLSF_ALIGNMENT = 16;
+
+/// @brief Two-Level Segregated Fit allocator for general purpose, variable sized blocks.
+/// Free blocks are binned by a first level (power of two) and a second level (linear
+/// subdivision) index, each backed by a bitmap, so both allocation and free are O(1).
+/// Neighbouring free blocks are merged on free. Memory comes from chunks that are
+/// requested on demand and released when they become completely free. Not thread-safe.
+class Tlsf {
+public:
+    /// @brief Create an allocator
+    /// @param chunk_size Minimum size in bytes of each chunk requested from the system
+    /// @param memory_tag Tag the chunks are accounted to
+    explicit Tlsf(usize chunk_size = TLSF_DEFAULT_CHUNK_SIZE, tag memory_tag = tag::UNTRACKED);
+    ~Tlsf();
+
+    /// @brief Allocate a block
+    /// @param size Size in bytes of the block
+    /// @param alignment Alignment of the block. Must be a power of two
+    /// @return Pointer to the block. nullptr if the system is out of memory
+    void* allocate(usize size, usize alignment = TLSF_ALIGNMENT);
+
+    /// @brief Return a block to the allocator
+    /// @param ptr Block returned by allocate()
+    void deallocate(void* ptr);
+
+    /// @brief Usable size in bytes of an allocated block. May be larger than requested
+    static usize block_size(const void* ptr);
+
+    usize reserved() const { return _reserved; }
+    usize in_use() const { return _in_use; }
+    usize chunk_count() const { return _chunk_count; }
+
+    /// @brief Largest allocation that goes through the bins. Bigger requests get a dedicated chunk
+    static constexpr usize BLOCK_SIZE_MAX = usize(1) << 31;
+private:
+    static constexpr u32 ALIGN_LOG2 = 4;
+    static constexpr u32 SL_INDEX_COUNT_LOG2 = 5;
+    static constexpr u32 SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+    static constexpr u32 FL_INDEX_MAX = 32;
+    static constexpr u32 FL_INDEX_SHIFT = SL_INDEX_COUNT_LOG2 + ALIGN_LOG2;
+    static constexpr u32 FL_INDEX_COUNT = FL_INDEX_MAX - FL_INDEX_SHIFT + 1;
+    static constexpr usize SMALL_BLOCK_SIZE = usize(1) << FL_INDEX_SHIFT;
+
+    struct Block;
+    struct Chunk;
+
+    void _add_chunk(usize min_payload);
+    void _release_chunk(Chunk* chunk);
+
+    static void _mapping(usize size, u32& fl, u32& sl);
+    void _insert_free(Block* block);
+    void _remove_free(Block* block);
+    Block* _find_free(usize size);
+    Block* _split(Block* block, usize size);
+    Block* _merge_prev(Block* block);
+    Block* _merge_next(Block* block);
+
+    usize _chunk_size;
+    tag _tag;
+    Chunk* _chunks { nullptr };
+    usize _chunk_count { 0 };
+    usize _reserved { 0 };      // bytes requested from the system
+    usize _in_use { 0 };        // payload bytes of allocated blocks
+
+    u32 _fl_bitmap { 0 };
+    u32 _sl_bitmap[FL_INDEX_COUNT] {};
+    Block* _free_lists[FL_INDEX_COUNT][SL_INDEX_COUNT] {};
+
+    Tlsf(const Tlsf&) = delete;
+    Tlsf& operator=(const Tlsf&) = delete;
+};
+
+} // memory namespace
+} // gravity namespace
@@ -0,0 +1,77 @@
+#pragma once
+#include "memory/memory.h"
+
+namespace gravity {
+namespace memory {
+
+/// @brief Default amount of memory a VirtualArena commits at a time
+constexpr usize VIRTUAL_ARENA_COMMIT_SIZE = 64 * 1024;
+
+/// @brief Size in bytes of a transparent huge page
+constexpr usize HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/// @brief Bump allocator over a reserved range of address space.
+/// Pages are committed as the arena grows and can be decommitted again with
+/// trim(), so a large buffer can grow in place without ever being copied and
+/// gives unused pages back to the OS. Committed bytes are accounted to the tag.
+class VirtualArena {
+public:
+    /// @brief Reserve address space for the arena. Nothing is committed yet
+    /// @param reserve_size Maximum size in bytes the arena can grow to
+    /// @param memory_tag Tag committed memory is accounted to
+    /// @param huge_pages Commit in huge page sized steps and ask for transparent huge pages
+    VirtualArena(usize reserve_size, tag memory_tag = tag::LINEAR_ALLOCATOR, bool huge_pages = false);
+    ~VirtualArena();
+
+    /// @brief Allocate a block at the end of the arena, committing pages as needed
+    /// @param size Size in bytes of the block
+    /// @param alignment Alignment of the block. Must be a power of two
+    /// @return Pointer to the block. nullptr if the reservation is exhausted
+    void* allocate(usize size, usize alignment = alignof(std::max_align_t)) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(_base);
+        uintptr_t aligned = (base + _position + (alignment - 1)) & ~(alignment - 1);
+        usize end = (aligned - base) + size;
+        if (end > _committed && !_commit_to(end)) {
+            return nullptr;
+        }
+
+        _position = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /// @brief Make sure the first `size` bytes of the arena are committed.
+    /// Lets the arena be used directly as a growable buffer starting at base()
+    /// @return true if successful false if `size` exceeds the reservation
+    bool ensure_committed(usize size) { return size <= _committed || _commit_to(size); }
+
+    /// @brief Roll the arena back to an earlier position()
+    void pop_to(usize position) { if (position < _position) _position = position; }
+
+    /// @brief Release every allocation. Pages stay committed until trim()
+    void reset() { _position = 0; }
+
+    /// @brief Decommit pages past the current position
+    /// @param keep Bytes to keep committed even if they are past the position
+    void trim(usize keep = 0);
+
+    u8* base() const { return _base; }
+    usize position() const { return _position; }
+    usize committed() const { return _committed; }
+    usize reserved() const { return _reserved; }
+private:
+    bool _commit_to(usize size);
+
+    u8* _base;                  // start of the reserved range
+    usize _reserved;            // size in bytes of the reserved range
+    usize _committed { 0 };     // bytes from _base backed by memory
+    usize _position { 0 };      // offset of the next free byte
+    usize _commit_step;         // granularity of commits
+    tag _tag;
+    bool _huge_pages;
+
+    VirtualArena(const VirtualArena&) = delete;
+    VirtualArena& operator=(const VirtualArena&) = delete;
+};
+
+} // memory namespace
+} // gravity namespace
@@ -2,6 +2,9 @@
 #include "core/defines.h"
 #include "core/types.h"
 #include "renderer/renderer.h"
+#include "containers/hash_map.h"
+#include "containers/slot_map.h"
+#include "core/string_id.h"
 // #include "core/events.h"
 
 #include <string>
@@ -154,6 +157,9 @@ enum class color : int {
     NUM_COLORS
 };
 
+/// @brief Generational handle to a window owned by the Platform
+using WindowId = containers::SlotHandle<Window*>;
+
 /// @brief Subsystem for handling platform-dependent tasks
 class Platform {
 public:
@@ -177,27 +183,54 @@ public:
     void console_error(color msg_color, const std::string& err);
     double get_absolute_time();
 
+    // Virtual memory. Static so the memory subsystem can use them before the platform starts up.
+    static usize page_size();
+    static void* reserve_memory(usize size, usize alignment = 0);
+    static bool commit_memory(void* address, usize size, bool huge_pages = false);
+    static void decommit_memory(void* address, usize size);
+    static void release_memory(void* address, usize size);
+
+    // Physical memory used by the process, in bytes
+    static usize resident_memory();
+    static usize peak_resident_memory();
+
     const Window* get_primary_window() const { 
-        auto w = _windows.find(_primary_window_name);
-        if (w == _windows.end()) {
+        if (!_primary_window) {
             std::printf("Platform lost primary window\n");
             exit(1);
         }
-        return w->second;
+        return _primary_window;
+    }
+
+    /// @brief Find a window by its handle
+    /// @return The window. nullptr if it has been destroyed
+    Window* get_window(WindowId id) const {
+        Window* const* window = _windows.get(id);
+        return window ? *window : nullptr;
+    }
+
+    /// @brief Find a window by the id of its name
+    /// @return The window. nullptr if there is none with that name
+    Window* get_window(core::StringId name) const {
+        auto w = _window_names.find(name);
+        return w == _window_names.end() ? nullptr : get_window(w->second);
     }
 
     #if defined(Q_PLATFORM_WINDOWS)
     Window* get_window_from_hwnd(HWND hwnd);
     #endif
 private:
-    Platform() {}
+    Platform()
+        : _windows(memory::tag::DARRAY)
+        , _window_names(memory::tag::HASHTABLE)
+    {}
     ~Platform() = default;
 
     static Platform* instance;
     
     // MEMBERS //
-    std::string _primary_window_name { "" };                           // name of the platform's primary window
-    std::unordered_map<std::string, Window*> _windows; // table of all created windows keyed on their names
+    containers::SlotMap<Window*> _windows;                         // every created window, packed for iteration
+    containers::HashMap<core::StringId, WindowId> _window_names;   // windows keyed on their interned names
     double clock_frequency;
     Window* _primary_window { nullptr };               // primary window of the application
     
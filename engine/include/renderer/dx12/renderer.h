@@ -104,7 +104,7 @@ private:
     DXDescriptorHeap _dsv_desc_heap  { D3D12_DESCRIPTOR_HEAP_TYPE_DSV };
     DXDescriptorHeap _srv_desc_heap  { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
     DXDescriptorHeap _uav_desc_heap  { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
-    std::vector<IUnknown*> _deferred_releases[NUM_FRAMES];
+    containers::DArray<IUnknown*> _deferred_releases[NUM_FRAMES];
     std::mutex _deferred_release_mutex;
 
     UINT curr_list = 0;
@@ -2,6 +2,7 @@
 #include "core/defines.h"
 #include "renderer/renderer.h"
 #include "renderer/dx12/fx.h"
+#include "containers/darray.h"
 #include <mutex>
 
 #if defined(Q_PLATFORM_WINDOWS)
@@ -54,7 +55,7 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE _cpu_start {};
     D3D12_GPU_DESCRIPTOR_HANDLE _gpu_start {};
     std::unique_ptr<u32[]> _free_handles {};
-    std::vector<u32> _deferred_free_indices[NUM_FRAMES];
+    containers::DArray<u32> _deferred_free_indices[NUM_FRAMES];
     std::mutex _mutex {};
     u32 _capacity { 0 };
     u32 _size { 0 };
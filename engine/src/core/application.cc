@@ -1,6 +1,7 @@
 #include <iostream>
 #include "core/application.h"
 #include "core/events/events.h"
+#include "memory/memory.h"
 
 namespace gravity {
 
@@ -13,6 +14,7 @@ Application* Application::instance = nullptr;
 /// @brief Startup behavior for the application. This starts up all necessary subsystems as well.
 Application* Application::startup(const std::string& name, u32 width, u32 height) noexcept {
     logger::Logger::startup();
+    memory::MemorySystem::startup();
     InputHandler::startup();
     EventHandler::startup();
 
@@ -59,9 +61,11 @@ Application* Application::startup(const std::string& name, u32 width, u32 height
 void Application::shutdown() noexcept {
     // NOTE: Shutdown in reverse order of the startup
     logger::Logger::get()->debug("Shutting down application...");
+    memory::MemorySystem::dump_info();
     InputHandler::shutdown();
     platform::Platform::shutdown();
     EventHandler::shutdown();
+    memory::MemorySystem::shutdown();
     logger::Logger::shutdown();
 
     std::cout << "Application shutdown successfully.\n";
@@ -73,8 +77,17 @@ void Application::run() {
     inst->state.is_running = true;
     
     logger::Logger::get()->info("Running application.");
+    f64 last_time = Platform::get()->get_absolute_time();
     while (inst->state.is_running == true) {
+        // Everything allocated from the frame arena last iteration is now dead
+        memory::MemorySystem::begin_frame();
+
         Platform::get()->pump_messages();
+
+        f64 now = Platform::get()->get_absolute_time();
+        InputHandler::get()->update(now - last_time);
+        last_time = now;
+
         EventHandler::get()->poll_events();
     }
 }
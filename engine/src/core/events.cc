@@ -1,6 +1,10 @@
 #include "core/events/events.h"
 #include "core/defines.h"
 #include "core/logger.h"
+#include "memory/memory.h"
+#include "containers/hash_map.h"
+
+#include <algorithm>
 
 
 namespace gravity {
@@ -8,54 +12,304 @@ namespace core {
 
 EventHandler* EventHandler::instance = nullptr;
 
+namespace {
+std::atomic<u32> next_handler_id { 1 };
+
+/// @brief Allocate event storage. Events cannot be dropped, so running out of memory here is fatal
+void* allocate_event_storage(usize size) {
+    void* block = memory::allocate(size, EVENT_ALIGNMENT, memory::tag::ENGINE);
+    if (!block) {
+        logger::Logger::get()->fatal("EventBuffer: failed to allocate %llu bytes of event storage",
+            static_cast<unsigned long long>(size));
+        exit(1);
+    }
+    return block;
+}
+
+/// @brief The producer a thread posts into. Handed back when the thread exits so another thread can reuse the slot
+struct ProducerLease {
+    u32 handler = 0;
+    EventProducer* producer = nullptr;
+    bool owned = false;     // false for a handler's shared producer, which is never handed back
+
+    ~ProducerLease() { release(); }
+
+    void release() {
+        if (owned) {
+            producer->retire();
+        }
+        handler = 0;
+        producer = nullptr;
+        owned = false;
+    }
+};
+
+thread_local ProducerLease lease;
+}
+
+EventProducer::EventProducer(bool shared)
+    : events(shared ? 1 : PRODUCER_QUEUE_CAPACITY)
+    , spilling(shared)
+    , shared(shared)
+{}
+
+EventProducer::~EventProducer() {
+    drain([](QueuedEvent& queued) { queued.move_to(nullptr, queued.storage); });
+}
+
+/// @brief Hand the slot back once the polling thread has drained it, or delete the producer if its handler is gone
+void EventProducer::retire() {
+    if (state.exchange(RETIRED, std::memory_order_acq_rel) == ORPHANED) {
+        delete this;
+    }
+}
+
+EventHandler::EventHandler()
+    : _id(next_handler_id.fetch_add(1, std::memory_order_relaxed))
+{}
+
+EventHandler::~EventHandler() {
+    _async.reset();
+    for (u32 i = 0; i < std::min(_producer_count.load(std::memory_order_acquire), MAX_EVENT_PRODUCERS); i++) {
+        EventProducer* producer = _producers[i].load(std::memory_order_acquire);
+        // A thread still holding its producer deletes it when it exits
+        if (producer && producer->state.exchange(EventProducer::ORPHANED, std::memory_order_acq_rel) != EventProducer::ACTIVE) {
+            delete producer;
+        }
+    }
+}
+
 /// @brief Register a function to execute when an event for a window was triggered
 /// @param window The window that we want to register this function to
 /// @param type The type of event
 /// @param callback The function to execute and register
-/// @param handler_name The name of the handler
+/// @param handler_name The name of the handler. Interned, so handlers sharing a name share its storage
 /// @param priority The priority we want this function to hold
+/// @param async Run the callback on the async workers. Callbacks of one window and event type still run in order
 void EventHandler::register_callback(
     const platform::Window* window,
     EventType type,
     EventCallback callback,
-    const std::string& handler_name,
-    EventPriority priority
+    std::string_view handler_name,
+    EventPriority priority,
+    bool async
 ) {
+    DispatchList& list = _dispatch[static_cast<u32>(type)];
+    auto [range_it, inserted] = list.windows.try_emplace(window, DispatchList::Range { 0, 0 });
+    DispatchList::Range& range = range_it.value();
+    if (inserted) {
+        // New windows start an empty run at the end of the list
+        range.begin = static_cast<u32>(list.callbacks.size());
+    }
+
     CallbackData data {
         .callback = callback,
-        .handler_name = handler_name,
+        .handler_name = StringId::intern(handler_name),
         .priority = priority,
-        .order_with_priority = static_cast<u32>(_callbacks[window][type].size()),
+        .order_with_priority = range.count,
+        .async = async,
     };
 
-    _callbacks[window][type].push_back(data);
-    std::sort(_callbacks[window][type].begin(), _callbacks[window][type].begin());
+    // Keep the window's run sorted by priority, then by registration order
+    CallbackData* first = list.callbacks.begin() + range.begin;
+    CallbackData* position = std::upper_bound(first, first + range.count, data);
+    list.callbacks.insert(position, data);
+    range.count++;
+
+    // Runs after the insertion point moved up by one
+    for (auto it = list.windows.begin(); it != list.windows.end(); ++it) {
+        DispatchList::Range& other = it.value();
+        if (&other != &range && other.begin >= range.begin) {
+            other.begin++;
+        }
+    }
 }
 
-/// @brief Post an event
-/// @param event The event
-/// @param immediate Whether this should execute immediately
-void EventHandler::post_event(std::unique_ptr<Event> event, bool immediate) {
-    _events.push(std::move(event));
+EventBuffer::EventBuffer(usize capacity)
+    : _data(static_cast<u8*>(allocate_event_storage(capacity)))
+    , _capacity(capacity)
+{}
+
+EventBuffer::~EventBuffer() {
+    clear();
+    memory::free(_data, _capacity, EVENT_ALIGNMENT, memory::tag::ENGINE);
+}
+
+/// @brief Slow path of allocate(): the main block is full, so chain another block for the rest of the frame
+/// @param record Size of the record including its header
+void* EventBuffer::_allocate_overflow(usize record) {
+    Overflow* block = _overflow_tail;
+    if (block == nullptr || block->used + record > block->capacity) {
+        usize capacity = std::max(record, block ? block->capacity * 2 : _capacity);
+        block = static_cast<Overflow*>(allocate_event_storage(OVERFLOW_HEADER + capacity));
+        block->next = nullptr;
+        block->capacity = capacity;
+        block->used = 0;
+
+        if (_overflow_tail) {
+            _overflow_tail->next = block;
+        } else {
+            _overflow_head = block;
+        }
+        _overflow_tail = block;
+    }
+
+    u8* header = _overflow_data(block) + block->used;
+    *reinterpret_cast<usize*>(header) = record;
+    block->used += record;
+    _count++;
+    return header + RECORD_HEADER;
+}
+
+void EventBuffer::clear() {
+    for_each([](Event& ev) { ev.~Event(); });
+
+    if (_overflow_head) {
+        // Grow so that a frame this busy fits in one block next time
+        usize needed = _used;
+        for (Overflow* block = _overflow_head; block;) {
+            Overflow* next = block->next;
+            needed += block->used;
+            memory::free(block, OVERFLOW_HEADER + block->capacity, EVENT_ALIGNMENT, memory::tag::ENGINE);
+            block = next;
+        }
+        _overflow_head = _overflow_tail = nullptr;
+
+        usize capacity = _capacity;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        logger::Logger::get()->debug("EventBuffer: %llu bytes of events in one frame, growing to %llu bytes",
+            static_cast<unsigned long long>(needed), static_cast<unsigned long long>(capacity));
+        u8* data = static_cast<u8*>(memory::allocate(capacity, EVENT_ALIGNMENT, memory::tag::ENGINE));
+        if (data) {
+            memory::free(_data, _capacity, EVENT_ALIGNMENT, memory::tag::ENGINE);
+            _data = data;
+            _capacity = capacity;
+        } else {
+            // Keep the current block; busy frames keep spilling into overflow blocks
+            logger::Logger::get()->error("EventBuffer: failed to grow to %llu bytes, keeping %llu",
+                static_cast<unsigned long long>(capacity), static_cast<unsigned long long>(_capacity));
+        }
+    }
+
+    _used = 0;
+    _count = 0;
 }
 
 /// @brief Poll all outstanding events and handle them
 void EventHandler::poll_events() {
-    std::vector<std::unique_ptr<Event>> current_events;
+    // Async callbacks from the last poll may still be reading its events
+    if (_async) {
+        _async->wait();
+    }
+    _buffers[_write_buffer ^ 1].clear();
+    _immediate_events.clear();
+
+    // Events posted by callbacks from here on land in the other buffer and wait for the next poll
+    EventBuffer& events = _buffers[_write_buffer];
+    _write_buffer ^= 1;
+    _merge_producers(events);
+    if (events.count() == 0) {
+        return;
+    }
+
+    memory::StackScope scratch;
+    _dispatching = true;
+    // Other threads never wait for a poll, so a frame can hold more events than the scratch stack has room to sort.
+    // DArray aligns its storage to max_align_t, so leave room for that much padding
+    if (events.count() * sizeof(Event*) + alignof(std::max_align_t) > scratch.stack().total_size() - scratch.stack().allocated()) {
+        // One pass per priority level, which needs no memory
+        for (u32 priority = 0; priority < EVENT_PRIORITIES; priority++) {
+            events.for_each([&](Event& ev) {
+                if (static_cast<u32>(ev.priority()) == priority) {
+                    _process_event(ev);
+                    _drain_immediate_events();
+                }
+            });
+        }
+    } else {
+        // Stable counting sort by priority: events of equal priority keep the order they were posted in
+        containers::DArray<Event*, 64, containers::ScratchAllocator> ordered(scratch.stack());
+        ordered.resize(events.count());
+
+        usize offsets[EVENT_PRIORITIES + 1] = {};
+        events.for_each([&](Event& ev) { offsets[static_cast<u32>(ev.priority()) + 1]++; });
+        for (u32 i = 1; i <= EVENT_PRIORITIES; i++) {
+            offsets[i] += offsets[i - 1];
+        }
+        events.for_each([&](Event& ev) { ordered[offsets[static_cast<u32>(ev.priority())]++] = &ev; });
+
+        for (Event* ev : ordered) {
+            _process_event(*ev);
+            _drain_immediate_events();
+        }
+    }
+    _dispatching = false;
+
+    // `events` is left for the next poll to clear, once async callbacks reading it are done
+}
+
+AsyncDispatcher::AsyncDispatcher(u32 worker_count)
+    : _workers(std::make_unique<Worker[]>(worker_count))
+    , _worker_count(worker_count)
+{
+    for (u32 i = 0; i < _worker_count; i++) {
+        _workers[i].thread = std::thread([this, i] { _run(_workers[i]); });
+    }
+}
+
+AsyncDispatcher::~AsyncDispatcher() {
+    // Workers finish whatever is queued before they exit
+    _stopping.store(true, std::memory_order_release);
+    for (u32 i = 0; i < _worker_count; i++) {
+        _workers[i].signal.fetch_add(1, std::memory_order_release);
+        _workers[i].signal.notify_one();
+    }
+    for (u32 i = 0; i < _worker_count; i++) {
+        _workers[i].thread.join();
+    }
+}
 
-    while (!_events.empty()) {
-        current_events.push_back(std::move(_events.front()));
-        _events.pop();
+void AsyncDispatcher::submit(EventCallback callback, Event& ev) {
+    // One worker per (window, EventType) stream keeps each stream in order
+    u64 stream = reinterpret_cast<uintptr_t>(&ev.source_window()) * 31 + static_cast<u64>(ev.type());
+    Worker& worker = _workers[containers::hash_mix(stream) % _worker_count];
+
+    _pending.fetch_add(1, std::memory_order_relaxed);
+    while (!worker.jobs.try_push(Job { callback, &ev })) {
+        // The worker is a full queue behind. Wait for it rather than break the stream's order
+        std::this_thread::yield();
     }
+    worker.signal.fetch_add(1, std::memory_order_release);
+    worker.signal.notify_one();
+}
 
-    std::sort(current_events.begin(), current_events.end(), 
-        [](const auto& a, const auto& b) {
-            return a->priority() < b->priority();
+void AsyncDispatcher::wait() {
+    for (u32 pending = _pending.load(std::memory_order_acquire); pending != 0; pending = _pending.load(std::memory_order_acquire)) {
+        _pending.wait(pending, std::memory_order_acquire);
+    }
+}
+
+/// @brief Worker thread loop. Runs queued callbacks and sleeps while the queue is empty
+/// @param worker The worker this thread serves
+void AsyncDispatcher::_run(Worker& worker) {
+    for (;;) {
+        u32 signal = worker.signal.load(std::memory_order_acquire);
+
+        Job job;
+        while (worker.jobs.try_pop(job)) {
+            EventContext context;
+            job.callback(*job.event, context);
+            if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                _pending.notify_all();
+            }
         }
-    );
 
-    for (auto& ev : current_events) {
-        _process_event(*ev);
+        if (_stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        worker.signal.wait(signal, std::memory_order_acquire);
     }
 }
 
@@ -68,6 +322,7 @@ bool EventHandler::startup() {
     }
 
     instance = new EventHandler();
+    return true;
 }
 
 /// @brief Get pointer to event system
@@ -92,35 +347,135 @@ void EventHandler::shutdown() {
     instance = nullptr;
 }
 
+/// @brief Producer that the calling thread posts into, claimed the first time the thread posts.
+/// Reuses the slot of a thread that has exited once its events are polled, and falls back to
+/// the shared producer when all MAX_EVENT_PRODUCERS slots are in use
+EventProducer* EventHandler::_thread_producer() {
+    if (lease.handler == _id) {
+        return lease.producer;
+    }
+    lease.release();
+
+    EventProducer* producer = nullptr;
+    u32 count = std::min(_producer_count.load(std::memory_order_acquire), MAX_EVENT_PRODUCERS);
+    for (u32 i = 0; i < count && !producer; i++) {
+        EventProducer* candidate = _producers[i].load(std::memory_order_acquire);
+        u32 expected = EventProducer::FREE;
+        if (candidate && candidate->state.compare_exchange_strong(expected, EventProducer::ACTIVE, std::memory_order_acquire)) {
+            producer = candidate;
+        }
+    }
+
+    if (!producer && count < MAX_EVENT_PRODUCERS) {
+        u32 index = _producer_count.fetch_add(1, std::memory_order_relaxed);
+        if (index < MAX_EVENT_PRODUCERS) {
+            producer = new EventProducer();
+            _producers[index].store(producer, std::memory_order_release);
+        }
+    }
+
+    lease.handler = _id;
+    lease.owned = producer != nullptr;
+    if (!producer) {
+        logger::Logger::get()->warn("EventHandler: more than %u threads posting events at once. This thread posts through the shared locked queue", MAX_EVENT_PRODUCERS);
+        producer = &_shared_producer;
+    }
+    lease.producer = producer;
+    return producer;
+}
+
+/// @brief Move events posted by other threads into the buffer about to be polled.
+/// Producers are taken in slot order, then the shared one, and each keeps its own order,
+/// so the merge, and the priority sort after it, are deterministic. Slots whose thread
+/// has exited are freed for reuse once drained
+/// @param events The buffer being polled
+void EventHandler::_merge_producers(EventBuffer& events) {
+    auto move_to_buffer = [&events](QueuedEvent& queued) {
+        queued.move_to(events.allocate(queued.size), queued.storage);
+    };
+
+    u32 count = std::min(_producer_count.load(std::memory_order_acquire), MAX_EVENT_PRODUCERS);
+    for (u32 i = 0; i < count; i++) {
+        EventProducer* producer = _producers[i].load(std::memory_order_acquire);
+        if (producer) {
+            // Read before draining: a retired thread posts nothing more, so the drain below takes its last event
+            bool retired = producer->state.load(std::memory_order_acquire) == EventProducer::RETIRED;
+            producer->drain(move_to_buffer);
+            if (retired) {
+                producer->state.store(EventProducer::FREE, std::memory_order_release);
+            }
+        }
+    }
+    _shared_producer.drain(move_to_buffer);
+}
+
+/// @brief Handle an immediate event posted outside of dispatch, along with any immediate events its callbacks post
+/// @param ev Event to process
+void EventHandler::_dispatch_immediate(Event& ev) {
+    _dispatching = true;
+    _process_event(ev);
+    _drain_immediate_events();
+    _dispatching = false;
+}
+
+/// @brief Handle the immediate events that callbacks posted during dispatch, in the order they were posted
+void EventHandler::_drain_immediate_events() {
+    // Callbacks run here can post more, which land at the end of the list
+    for (usize i = 0; i < _pending_immediate.size(); i++) {
+        _process_event(*_pending_immediate[i]);
+    }
+    _pending_immediate.clear();
+}
+
+/// @brief Hand a callback to the async workers, starting them on first use
+/// @param callback Callback to run
+/// @param ev Event to run it with. Stays alive until the next poll_events()
+void EventHandler::_dispatch_async(EventCallback callback, Event& ev) {
+    if (!_async) {
+        u32 cores = std::thread::hardware_concurrency();
+        u32 workers = std::clamp<u32>(cores > 1 ? cores - 1 : 1, 1, MAX_ASYNC_WORKERS);
+        _async = std::make_unique<AsyncDispatcher>(workers);
+        logger::Logger::get()->debug("EventHandler: started %u async event workers", workers);
+    }
+    _async->submit(callback, ev);
+}
+
 /// @brief Process an individual event
 /// @param ev Event to process
 void EventHandler::_process_event(Event& ev) {
-    // auto& source_window = ev->source_window();
-    auto& source_window = ev.source_window();
-    _process_window_event(ev, &source_window);
+    const DispatchList& list = _dispatch[static_cast<u32>(ev.type())];
+    if (list.callbacks.empty()) {
+        return;
+    }
+
+    _process_window_event(ev, list, &ev.source_window());
 
     if (ev.propogation().propogate) {
-        _process_window_event(ev, nullptr);
+        _process_window_event(ev, list, nullptr);
     }
 }
 
 /// @brief Process an event for a given window
 /// @param ev Event to process
+/// @param list Callbacks registered for the event's type
 /// @param window Window to process
-void EventHandler::_process_window_event(Event& ev, const platform::Window* window) {
-    auto wnd_it = _callbacks.find(window);
-    if (wnd_it == _callbacks.end()) {
+void EventHandler::_process_window_event(Event& ev, const DispatchList& list, const platform::Window* window) {
+    auto it = list.windows.find(window);
+    if (it == list.windows.end()) {
         return;
     }
 
-    auto type_it = wnd_it->second.find(ev.type());
-    if (type_it == wnd_it->second.end()) {
-        return;
-    }
+    const DispatchList::Range range = it.value();
+    bool all_async = ev.propogation().async;
+    for (u32 i = range.begin; i < range.begin + range.count; i++) {
+        const CallbackData& data = list.callbacks[i];
+        if (data.async || all_async) {
+            _dispatch_async(data.callback, ev);
+            continue;
+        }
 
-    for (auto& callback_data : type_it->second) {
         EventContext context;
-        callback_data.callback(ev, context);
+        data.callback(ev, context);
     }
 }
 
@@ -10,6 +10,22 @@ namespace core {
 
 using namespace logger;
 
+namespace {
+
+/// @brief Work out which keys and buttons changed since the last update and make the current state the previous one
+template <typename STATE>
+void advance_state(STATE& state) {
+    state.edges.keys_pressed = KeySet::and_not(state.keyboard_curr_state.keys, state.keyboard_prev_state.keys);
+    state.edges.keys_released = KeySet::and_not(state.keyboard_prev_state.keys, state.keyboard_curr_state.keys);
+    state.edges.buttons_pressed = ButtonSet::and_not(state.mouse_curr_state.buttons, state.mouse_prev_state.buttons);
+    state.edges.buttons_released = ButtonSet::and_not(state.mouse_prev_state.buttons, state.mouse_curr_state.buttons);
+
+    state.keyboard_prev_state = state.keyboard_curr_state;
+    state.mouse_prev_state = state.mouse_curr_state;
+}
+
+} // anonymous namespace
+
 // Singleton instance for the input handler
 InputHandler* InputHandler::handler_instance = nullptr;
 
@@ -49,6 +65,7 @@ InputHandler* InputHandler::get() {
 
 /// @brief Constructor
 InputHandler::InputHandler() 
+    : _window_states(memory::tag::HASHTABLE)
 {
     m_state.is_initialized = true;
 }
@@ -65,9 +82,17 @@ void InputHandler::update(f64 delta_time) {
         return;
     }
 
-    // Copy current state to prev
-    m_state.keyboard_prev_state = m_state.keyboard_curr_state;
-    m_state.mouse_prev_state = m_state.mouse_curr_state;
+    advance_state(m_state);
+    for (auto& [wnd, state] : _window_states) {
+        advance_state(state);
+    }
+}
+
+/// @brief Input state of a single window
+/// @return The state. nullptr if the window is not registered
+const WindowInputState* InputHandler::window_state(platform::Window* wnd) const {
+    auto it = _window_states.find(wnd);
+    return it == _window_states.end() ? nullptr : &it->second;
 }
 
 /// @brief Register a new window to receive input events
@@ -113,21 +138,23 @@ void InputHandler::set_focused_window(platform::Window* wnd) {
     if (_focused_window) {
         _window_states[_focused_window].in_focus = false;
         EventHandler::get()->post_event(
-            std::make_unique<WindowFocusLostEvent>(
-                WindowFocusLostEvent(*_focused_window)
-            ),
+            WindowFocusLostEvent(*_focused_window),
             true
         );
     }
 
     _focused_window = wnd;
 
+    // The handler-wide state follows the focused window
+    m_state.keyboard_curr_state = {};
+    m_state.mouse_curr_state.buttons.clear();
     if (wnd) {
-        _window_states[wnd].in_focus = true;
+        auto& state = _window_states[wnd];
+        state.in_focus = true;
+        m_state.keyboard_curr_state = state.keyboard_curr_state;
+        m_state.mouse_curr_state.buttons = state.mouse_curr_state.buttons;
         EventHandler::get()->post_event(
-            std::make_unique<WindowFocusGainedEvent>(
-                WindowFocusGainedEvent(*wnd)
-            ),
+            WindowFocusGainedEvent(*wnd),
             true
         );
     }
@@ -162,24 +189,19 @@ void InputHandler::process_key(Keys key, bool pressed) {
                 break;
         }
         
-        if (state.keyboard_curr_state.keys[key] != pressed) {
-            state.keyboard_curr_state.keys[key] = pressed;
+        m_state.keyboard_curr_state.keys.set(key, pressed);
+        if (state.keyboard_curr_state.keys.test(key) != pressed) {
+            state.keyboard_curr_state.keys.set(key, pressed);
 
             if (pressed) {
                 EventHandler::get()->post_event(
-                    std::make_unique<KeyPressedEvent>(
-                        *_focused_window,
-                        key
-                    ),
+                    KeyPressedEvent(*_focused_window, key),
                     false
                 );
             } else {
                 EventHandler::get()->post_event(
-                    std::make_unique<KeyReleasedEvent>(
-                        *_focused_window,
-                        key
-                    ),
-                   false
+                    KeyReleasedEvent(*_focused_window, key),
+                    false
                 );
             }
 
@@ -195,6 +217,19 @@ void InputHandler::process_key(Keys key, bool pressed) {
     }
 }
 
+/// @brief Handle the input of a mouse button being pressed or released
+/// @param button The button that was input
+/// @param pressed True if the button is pressed. False if released.
+/// @param wnd Window the button was pressed in
+void InputHandler::process_buttons(MouseButtons button, bool pressed, platform::Window* wnd) {
+    if (wnd == _focused_window) {
+        m_state.mouse_curr_state.buttons.set(button, pressed);
+    }
+    if (wnd) {
+        _window_states[wnd].mouse_curr_state.buttons.set(button, pressed);
+    }
+}
+
 /// @brief Process the moving of the mouse wheel
 /// @param z_delta How much the wheel has moved
 void InputHandler::process_mouse_wheel(i32 z_delta) {
@@ -224,81 +259,5 @@ void InputHandler::process_mouse_move(i32 x, i32 y) {
     // }
 }
 
-
-/// PRIVATE ///
-
-bool InputHandler::_is_button_down(MouseButtons button) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.mouse_curr_state.buttons[button] == false;
-}
-
-bool InputHandler::_was_button_down(MouseButtons button) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.mouse_prev_state.buttons[button] == true;
-}
-
-
-bool InputHandler::_is_button_up(MouseButtons button) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.mouse_curr_state.buttons[button] == true;
-}
-
-bool InputHandler::_was_button_up(MouseButtons button) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.mouse_prev_state.buttons[button] == false;
-}
-
-bool InputHandler::_is_key_down(Keys key) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.keyboard_curr_state.keys[key] == true;
-}
-
-bool InputHandler::_was_key_down(Keys key) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.keyboard_prev_state.keys[key] == true;
-}
-
-bool InputHandler::_is_key_up(Keys key) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-
-    return m_state.keyboard_curr_state.keys[key] == true;
-}
-
-bool InputHandler::_was_key_up(Keys key) {
-    if (!m_state.is_initialized) {
-        Logger::get()->warn("InputHandler: trying to access uninitialized handler.");
-        return false;
-    }
-    
-    return m_state.keyboard_curr_state.keys[key] == false;
-}
-
 } // core namespace
 } // gravity namespace
\ No newline at end of file
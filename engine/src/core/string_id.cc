@@ -0,0 +1,108 @@
+#include "core/string_id.h"
+#include "core/logger.h"
+#include "memory/memory.h"
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+namespace gravity {
+namespace core {
+using namespace logger;
+
+namespace {
+
+// Interned text is packed into blocks of this size; longer strings get a block of their own
+constexpr usize STRING_BLOCK_SIZE = 16 * 1024;
+
+/// @brief Allocate memory for interned text. Interning has no way to fail, so running out of memory is fatal
+char* allocate_string_storage(usize size) {
+    void* block = memory::allocate(size, 1, memory::tag::STRING);
+    if (!block) {
+        Logger::get()->fatal("StringId: failed to allocate %llu bytes of string storage",
+            static_cast<unsigned long long>(size));
+        exit(1);
+    }
+    return static_cast<char*>(block);
+}
+
+/// @brief Every interned string, keyed by hash. The text is never freed so
+/// views handed out by StringId::str() stay valid for the life of the process.
+class StringTable {
+public:
+    StringTable() : _strings(memory::tag::STRING) {}
+
+    StringId intern(std::string_view str) {
+        StringId id(str);
+        std::lock_guard<std::mutex> guard(_lock);
+
+        auto it = _strings.find(id.value());
+        if (it != _strings.end()) {
+            if (it->second != str) {
+                Logger::get()->error(
+                    "StringId: '%.*s' and '%.*s' hash to the same id.",
+                    static_cast<int>(str.size()), str.data(),
+                    static_cast<int>(it->second.size()), it->second.data()
+                );
+                assert(false && "StringId hash collision");
+            }
+            return id;
+        }
+
+        _strings.try_emplace(id.value(), _store(str));
+        return id;
+    }
+
+    std::string_view find(StringId id) {
+        std::lock_guard<std::mutex> guard(_lock);
+        auto it = _strings.find(id.value());
+        return it == _strings.end() ? std::string_view() : it->second;
+    }
+private:
+    /// @brief Copy `str` into the current block, null terminated
+    std::string_view _store(std::string_view str) {
+        usize size = str.size() + 1;
+        char* text;
+        if (size > STRING_BLOCK_SIZE / 4) {
+            text = allocate_string_storage(size);
+        } else {
+            if (_block_used + size > STRING_BLOCK_SIZE || !_block) {
+                _block = allocate_string_storage(STRING_BLOCK_SIZE);
+                _block_used = 0;
+            }
+            text = _block + _block_used;
+            _block_used += size;
+        }
+
+        std::memcpy(text, str.data(), str.size());
+        text[str.size()] = '\0';
+        return std::string_view(text, str.size());
+    }
+
+    std::mutex _lock;
+    containers::HashMap<u64, std::string_view> _strings;
+    char* _block { nullptr };   // block new strings are copied into
+    usize _block_used { 0 };
+};
+
+/// @brief Created on first use and never destroyed, so ids can be interned
+/// during static initialisation and resolved during shutdown
+StringTable& string_table() {
+    static StringTable* table = new StringTable();
+    return *table;
+}
+
+} // anonymous namespace
+
+/// @brief Id of `str`, storing the text in the intern table if it is not there yet
+StringId StringId::intern(std::string_view str) {
+    return string_table().intern(str);
+}
+
+/// @brief Interned text of the id. Empty if the string was never interned
+std::string_view StringId::str() const {
+    return string_table().find(*this);
+}
+
+} // core namespace
+} // gravity namespace
@@ -0,0 +1,285 @@
+#include "memory/allocation_trace.h"
+#include "core/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace gravity {
+namespace memory {
+using namespace core::logger;
+
+namespace {
+
+constexpr u32 TRACE_MAGIC = 0x43525447;  // "GTRC"
+constexpr u32 TRACE_VERSION = 1;
+constexpr usize TRACE_BUFFER_SIZE = 64 * 1024;
+// Longest possible record: op/alignment byte, tag byte and three 10 byte varints
+constexpr usize TRACE_RECORD_MAX = 2 + 3 * 10;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+};
+
+/// @brief Written in front of each buffer of records. Addresses and timestamps
+/// in the records are deltas from the previous record, starting at these values
+struct ChunkHeader {
+    u32 size;
+    u16 thread;
+    u16 reserved;
+    u64 timestamp;
+    u64 address;
+};
+
+/// @brief Records of one thread that have not been written out yet.
+/// Allocated with malloc so recording never recurses into operator new.
+struct ThreadBuffer {
+    ThreadBuffer* next;
+    bool in_use;
+    u16 thread;
+    usize used;
+    u64 first_timestamp;
+    u64 first_address;
+    u64 last_timestamp;
+    u64 last_address;
+    u8 data[TRACE_BUFFER_SIZE];
+};
+
+std::mutex trace_lock;
+FILE* trace_file = nullptr;
+ThreadBuffer* buffers_head = nullptr;  // every buffer ever created, reused after thread exit
+std::chrono::steady_clock::time_point start_time;
+
+/// @brief Write a buffer out as a chunk. trace_lock must be held
+void flush(ThreadBuffer* buffer) {
+    if (buffer->used && trace_file) {
+        ChunkHeader header { static_cast<u32>(buffer->used), buffer->thread, 0, buffer->first_timestamp, buffer->first_address };
+        fwrite(&header, sizeof(header), 1, trace_file);
+        fwrite(buffer->data, 1, buffer->used, trace_file);
+    }
+    buffer->used = 0;
+}
+
+ThreadBuffer* acquire_buffer() {
+    std::lock_guard<std::mutex> guard(trace_lock);
+    ThreadBuffer* buffer = buffers_head;
+    while (buffer && buffer->in_use) {
+        buffer = buffer->next;
+    }
+    if (!buffer) {
+        buffer = static_cast<ThreadBuffer*>(std::malloc(sizeof(ThreadBuffer)));
+        if (!buffer) {
+            return nullptr;
+        }
+        buffer->next = buffers_head;
+        buffers_head = buffer;
+    }
+
+    buffer->in_use = true;
+    buffer->thread = static_cast<u16>(thread_index());
+    buffer->used = 0;
+    return buffer;
+}
+
+/// @brief Hands the thread's buffer back when it exits
+struct LocalBuffer {
+    ThreadBuffer* buffer { nullptr };
+
+    ~LocalBuffer() {
+        if (buffer) {
+            std::lock_guard<std::mutex> guard(trace_lock);
+            flush(buffer);
+            buffer->in_use = false;
+        }
+    }
+};
+
+thread_local LocalBuffer local_buffer;
+
+PINLINE u8* write_varint(u8* out, u64 value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<u8>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<u8>(value);
+    return out;
+}
+
+PINLINE bool read_varint(const u8*& in, const u8* end, u64& value) {
+    value = 0;
+    for (u32 shift = 0; in < end && shift < 64; shift += 7) {
+        u8 byte = *in++;
+        value |= static_cast<u64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PINLINE u64 zigzag(u64 delta) {
+    return (delta << 1) ^ static_cast<u64>(static_cast<i64>(delta) >> 63);
+}
+
+PINLINE u64 unzigzag(u64 value) {
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+} // anonymous namespace
+
+/// @brief Start recording to a file, replacing it if it exists
+/// @param path Path of the trace file
+/// @return true if successful false otherwise
+bool AllocationTrace::start(const char* path) {
+    std::lock_guard<std::mutex> guard(trace_lock);
+    if (trace_file) {
+        Logger::get()->error("AllocationTrace: already recording.");
+        return false;
+    }
+
+    trace_file = fopen(path, "wb");
+    if (!trace_file) {
+        Logger::get()->error("AllocationTrace: unable to open %s for writing.", path);
+        return false;
+    }
+
+    FileHeader header { TRACE_MAGIC, TRACE_VERSION };
+    fwrite(&header, sizeof(header), 1, trace_file);
+    start_time = std::chrono::steady_clock::now();
+    _recording.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+/// @brief Flush every thread's buffer and close the file. Other threads must
+/// not be allocating while this runs
+void AllocationTrace::stop() {
+    _recording.store(false, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> guard(trace_lock);
+    for (ThreadBuffer* buffer = buffers_head; buffer; buffer = buffer->next) {
+        flush(buffer);
+    }
+    if (trace_file) {
+        fclose(trace_file);
+        trace_file = nullptr;
+    }
+}
+
+/// @brief Append a record for the calling thread
+/// @param op What happened
+/// @param block Block allocated or freed. nullptr for frame markers
+/// @param size Size in bytes of the block
+/// @param alignment Alignment of the block. Must be a power of two
+/// @param memory_tag Tag the block is accounted to
+void AllocationTrace::record(TraceOp op, const void* block, usize size, usize alignment, tag memory_tag) {
+    ThreadBuffer* buffer = local_buffer.buffer;
+    if (!buffer) {
+        buffer = local_buffer.buffer = acquire_buffer();
+        if (!buffer) return;
+    }
+
+    if (buffer->used + TRACE_RECORD_MAX > TRACE_BUFFER_SIZE) {
+        std::lock_guard<std::mutex> guard(trace_lock);
+        flush(buffer);
+    }
+
+    u64 timestamp = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time
+    ).count());
+    u64 address = static_cast<u64>(reinterpret_cast<uintptr_t>(block));
+    if (buffer->used == 0) {
+        buffer->first_timestamp = buffer->last_timestamp = timestamp;
+        buffer->first_address = buffer->last_address = address;
+    }
+
+    u8 alignment_shift = 0;
+    while ((static_cast<usize>(1) << alignment_shift) < alignment) {
+        alignment_shift++;
+    }
+
+    u8* out = buffer->data + buffer->used;
+    *out++ = static_cast<u8>(static_cast<u8>(op) | (alignment_shift << 2));
+    *out++ = static_cast<u8>(memory_tag);
+    out = write_varint(out, size);
+    out = write_varint(out, zigzag(address - buffer->last_address));
+    out = write_varint(out, timestamp - buffer->last_timestamp);
+    buffer->used = static_cast<usize>(out - buffer->data);
+    buffer->last_address = address;
+    buffer->last_timestamp = timestamp;
+}
+
+/// @brief Read every record of a trace file, ordered by timestamp
+/// @param path Path of the trace file
+/// @param out Called once per record
+/// @param user Passed through to `out`
+/// @return true if the file was a valid trace
+bool AllocationTrace::read(const char* path, void (*out)(const TraceRecord& record, void* user), void* user) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    FileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+        fclose(file);
+        return false;
+    }
+
+    std::vector<TraceRecord> records;
+    std::vector<u8> data;
+    ChunkHeader chunk;
+    bool valid = true;
+    while (valid && fread(&chunk, sizeof(chunk), 1, file) == 1) {
+        data.resize(chunk.size);
+        if (fread(data.data(), 1, chunk.size, file) != chunk.size) {
+            valid = false;
+            break;
+        }
+
+        const u8* in = data.data();
+        const u8* end = in + data.size();
+        u64 address = chunk.address;
+        u64 timestamp = chunk.timestamp;
+        while (in < end) {
+            if (end - in < 2) {
+                valid = false;
+                break;
+            }
+            TraceRecord record;
+            record.op = static_cast<TraceOp>(in[0] & 0x3);
+            record.alignment = static_cast<usize>(1) << (in[0] >> 2);
+            record.memory_tag = static_cast<tag>(in[1]);
+            record.thread = chunk.thread;
+            in += 2;
+
+            u64 size, address_delta, time_delta;
+            if (!read_varint(in, end, size) || !read_varint(in, end, address_delta) || !read_varint(in, end, time_delta)) {
+                valid = false;
+                break;
+            }
+            address += unzigzag(address_delta);
+            timestamp += time_delta;
+            record.size = static_cast<usize>(size);
+            record.address = address;
+            record.timestamp_ns = timestamp;
+            records.push_back(record);
+        }
+    }
+    fclose(file);
+
+    // Chunks are written whenever a thread's buffer fills, so merge the threads back by time
+    std::stable_sort(records.begin(), records.end(), [](const TraceRecord& a, const TraceRecord& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    for (const TraceRecord& record : records) {
+        out(record, user);
+    }
+    return valid;
+}
+
+} // memory namespace
+} // gravity namespace
@@ -0,0 +1,236 @@
+#include "memory/allocation_tracker.h"
+#include "core/logger.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace gravity {
+namespace memory {
+using namespace core::logger;
+
+namespace {
+
+// Plain thread_locals only: anything with a constructor could allocate from inside the hooks
+thread_local tag current_tag = tag::UNKNOWN;
+thread_local u64 thread_allocations = 0;
+thread_local bool suspended = false;
+
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+
+struct FrameCounters {
+    std::atomic<u64> allocations { 0 };
+    std::atomic<u64> frees { 0 };
+    std::atomic<usize> bytes_allocated { 0 };
+    std::atomic<usize> bytes_freed { 0 };
+    std::atomic<u64> tag_allocations[tag::MAX_TAGS] {};
+    std::atomic<usize> tag_bytes[tag::MAX_TAGS] {};
+    std::atomic<u64> tag_frees[tag::MAX_TAGS] {};
+    std::atomic<usize> tag_bytes_freed[tag::MAX_TAGS] {};
+};
+
+FrameCounters counters;
+FrameAllocationStats last_stats;
+u64 frame_number = 0;
+AllocationFreeMode frame_mode = AllocationFreeMode::OFF;
+
+/// @brief Bookkeeping stored in front of every block handed out by the hooks
+struct alignas(16) Header {
+    usize size;
+    u32 offset;  // distance from the malloc'd pointer to the block
+    u32 memory_tag;  // tag active when the block was allocated, so its free is attributed to the same tag
+};
+
+void* tracked_allocate(usize size, usize alignment) {
+    usize padding = std::max(sizeof(Header), alignment);
+    u8* raw = static_cast<u8*>(std::malloc(size + padding));
+    if (!raw) {
+        return nullptr;
+    }
+
+    uintptr_t block = (reinterpret_cast<uintptr_t>(raw) + sizeof(Header) + (alignment - 1)) & ~(alignment - 1);
+    Header* header = reinterpret_cast<Header*>(block) - 1;
+    header->size = size;
+    header->offset = static_cast<u32>(block - reinterpret_cast<uintptr_t>(raw));
+    header->memory_tag = current_tag;
+
+    if (!suspended) {
+        thread_allocations += 1;
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+        counters.tag_allocations[current_tag].fetch_add(1, std::memory_order_relaxed);
+        counters.tag_bytes[current_tag].fetch_add(size, std::memory_order_relaxed);
+    }
+    return reinterpret_cast<void*>(block);
+}
+
+void tracked_free(void* block) {
+    if (!block) return;
+
+    Header* header = static_cast<Header*>(block) - 1;
+    if (!suspended) {
+        u32 memory_tag = header->memory_tag < tag::MAX_TAGS ? header->memory_tag : tag::UNKNOWN;
+        counters.frees.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes_freed.fetch_add(header->size, std::memory_order_relaxed);
+        counters.tag_frees[memory_tag].fetch_add(1, std::memory_order_relaxed);
+        counters.tag_bytes_freed[memory_tag].fetch_add(header->size, std::memory_order_relaxed);
+    }
+    std::free(static_cast<u8*>(block) - header->offset);
+}
+
+void* tracked_new(usize size, usize alignment) {
+    void* block = tracked_allocate(size, alignment);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+#endif // GRAVITY_TRACK_ALLOCATIONS
+
+/// @brief Report an allocation where none was allowed
+void report_violation(AllocationFreeMode mode, const char* what, u64 allocations, usize bytes) {
+    suspended = true;
+    Logger::get()->error(
+        "AllocationTracker: %s performed %llu heap allocations (%zu bytes) but is marked allocation-free.",
+        what,
+        static_cast<unsigned long long>(allocations),
+        bytes
+    );
+    suspended = false;
+
+    if (mode == AllocationFreeMode::ASSERT) {
+        std::abort();
+    }
+}
+
+} // anonymous namespace
+
+/// @brief Attribute global operator new calls on this thread to `memory_tag`
+TagScope::TagScope(tag memory_tag)
+    : _previous(current_tag)
+{
+    current_tag = memory_tag < tag::MAX_TAGS ? memory_tag : tag::UNKNOWN;
+}
+
+/// @brief Restore the tag that was active before this scope
+TagScope::~TagScope() {
+    current_tag = _previous;
+}
+
+/// @brief Whether the global operators are hooked in this build
+bool AllocationTracker::enabled() {
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// @brief Close the current frame: publish its stats, run the allocation-free
+/// check and start counting the next one
+void AllocationTracker::next_frame() {
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+    FrameAllocationStats stats;
+    stats.frame = frame_number++;
+    stats.allocations = counters.allocations.exchange(0, std::memory_order_relaxed);
+    stats.frees = counters.frees.exchange(0, std::memory_order_relaxed);
+    stats.bytes_allocated = counters.bytes_allocated.exchange(0, std::memory_order_relaxed);
+    stats.bytes_freed = counters.bytes_freed.exchange(0, std::memory_order_relaxed);
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        stats.tag_allocations[i] = counters.tag_allocations[i].exchange(0, std::memory_order_relaxed);
+        stats.tag_bytes[i] = counters.tag_bytes[i].exchange(0, std::memory_order_relaxed);
+        stats.tag_frees[i] = counters.tag_frees[i].exchange(0, std::memory_order_relaxed);
+        stats.tag_bytes_freed[i] = counters.tag_bytes_freed[i].exchange(0, std::memory_order_relaxed);
+    }
+    last_stats = stats;
+
+    if (frame_mode != AllocationFreeMode::OFF && stats.allocations != 0) {
+        suspended = true;
+        for (usize i = 0; i < tag::MAX_TAGS; i++) {
+            if (stats.tag_allocations[i]) {
+                Logger::get()->error(
+                    "AllocationTracker:   %s: %llu allocations, %zu bytes; %llu frees, %zu bytes",
+                    tag_name(static_cast<tag>(i)),
+                    static_cast<unsigned long long>(stats.tag_allocations[i]),
+                    stats.tag_bytes[i],
+                    static_cast<unsigned long long>(stats.tag_frees[i]),
+                    stats.tag_bytes_freed[i]
+                );
+            }
+        }
+        suspended = false;
+        report_violation(frame_mode, "frame", stats.allocations, stats.bytes_allocated);
+    }
+#endif
+}
+
+/// @brief Stats for the last completed frame. All zero unless tracking is enabled
+const FrameAllocationStats& AllocationTracker::last_frame() {
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+    return last_stats;
+#else
+    static const FrameAllocationStats empty;
+    return empty;
+#endif
+}
+
+/// @brief Check every following frame for heap allocations
+/// @param mode What to do when a frame allocates
+void AllocationTracker::expect_allocation_free_frames(AllocationFreeMode mode) {
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+    frame_mode = mode;
+#else
+    (void)mode;
+#endif
+}
+
+/// @brief Start checking the calling thread for heap allocations
+/// @param name Name of the scope for the report
+/// @param mode What to do when the scope allocates
+AllocationFreeScope::AllocationFreeScope(const char* name, AllocationFreeMode mode)
+    : _name(name)
+    , _mode(mode)
+    , _start_allocations(thread_allocations)
+{}
+
+/// @brief Report if the thread allocated since construction
+AllocationFreeScope::~AllocationFreeScope() {
+    u64 allocations = thread_allocations - _start_allocations;
+    if (_mode != AllocationFreeMode::OFF && allocations != 0) {
+        report_violation(_mode, _name, allocations, 0);
+    }
+}
+
+} // memory namespace
+} // gravity namespace
+
+#ifdef GRAVITY_TRACK_ALLOCATIONS
+// Replacements for every form of the global allocation operators. They live in
+// the same translation unit as AllocationTracker so linking the tracker pulls them in.
+using gravity::usize;
+using gravity::memory::tracked_new;
+using gravity::memory::tracked_allocate;
+using gravity::memory::tracked_free;
+
+void* operator new(usize size) { return tracked_new(size, alignof(std::max_align_t)); }
+void* operator new[](usize size) { return tracked_new(size, alignof(std::max_align_t)); }
+void* operator new(usize size, const std::nothrow_t&) noexcept { return tracked_allocate(size, alignof(std::max_align_t)); }
+void* operator new[](usize size, const std::nothrow_t&) noexcept { return tracked_allocate(size, alignof(std::max_align_t)); }
+void* operator new(usize size, std::align_val_t al) { return tracked_new(size, static_cast<usize>(al)); }
+void* operator new[](usize size, std::align_val_t al) { return tracked_new(size, static_cast<usize>(al)); }
+void* operator new(usize size, std::align_val_t al, const std::nothrow_t&) noexcept { return tracked_allocate(size, static_cast<usize>(al)); }
+void* operator new[](usize size, std::align_val_t al, const std::nothrow_t&) noexcept { return tracked_allocate(size, static_cast<usize>(al)); }
+
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete[](void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, usize) noexcept { tracked_free(p); }
+void operator delete[](void* p, usize) noexcept { tracked_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete(void* p, usize, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete[](void* p, usize, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_free(p); }
+#endif // GRAVITY_TRACK_ALLOCATIONS
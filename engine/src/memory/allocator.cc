@@ -0,0 +1,190 @@
+#include "memory/memory.h"
+#include "memory/allocation_trace.h"
+#include "memory/tlsf.h"
+
+#include <array>
+#include <mutex>
+#include <utility>
+
+namespace gravity {
+namespace memory {
+
+namespace {
+
+constexpr usize SMALL_ALIGNMENT = 16;
+constexpr usize size_classes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024,
+};
+constexpr usize SIZE_CLASS_COUNT = sizeof(size_classes) / sizeof(size_classes[0]);
+static_assert(size_classes[SIZE_CLASS_COUNT - 1] == SMALL_ALLOCATION_MAX, "Largest size class must match SMALL_ALLOCATION_MAX");
+
+// Blocks a thread keeps per size class before handing half of them back
+constexpr u32 THREAD_CACHE_SIZE = 32;
+
+/// @brief Size class index for every multiple of SMALL_ALIGNMENT up to SMALL_ALLOCATION_MAX
+struct SizeClassTable {
+    u8 index[(SMALL_ALLOCATION_MAX / SMALL_ALIGNMENT) + 1] {};
+
+    constexpr SizeClassTable() {
+        usize c = 0;
+        for (usize i = 0; i <= SMALL_ALLOCATION_MAX / SMALL_ALIGNMENT; i++) {
+            while (size_classes[c] < i * SMALL_ALIGNMENT) {
+                c++;
+            }
+            index[i] = static_cast<u8>(c);
+        }
+    }
+};
+constexpr SizeClassTable size_class_table;
+
+PINLINE usize size_class(usize size) {
+    return size_class_table.index[(size + (SMALL_ALIGNMENT - 1)) / SMALL_ALIGNMENT];
+}
+
+/// @brief Shared pool behind one size class. Threads only lock it to move a
+/// batch of blocks in or out of their cache.
+template <usize I>
+struct SizeClass {
+    using pool_type = Pool<size_classes[I], 256, SMALL_ALIGNMENT>;
+
+    static pool_type& pool() {
+        static pool_type pool(tag::UNTRACKED, PoolGrowth::GROW_AND_RELEASE);
+        return pool;
+    }
+
+    static std::mutex& lock() {
+        static std::mutex lock;
+        return lock;
+    }
+
+    static u32 refill(void** out, u32 count) {
+        std::lock_guard<std::mutex> guard(lock());
+        for (u32 i = 0; i < count; i++) {
+            out[i] = pool().allocate();
+        }
+        return count;
+    }
+
+    static void flush(void* const* blocks, u32 count) {
+        std::lock_guard<std::mutex> guard(lock());
+        for (u32 i = 0; i < count; i++) {
+            pool().deallocate(blocks[i]);
+        }
+    }
+};
+
+struct SizeClassOps {
+    u32 (*refill)(void**, u32);
+    void (*flush)(void* const*, u32);
+};
+
+template <usize... I>
+constexpr auto make_size_class_ops(std::index_sequence<I...>) {
+    return std::array<SizeClassOps, sizeof...(I)> {{ { &SizeClass<I>::refill, &SizeClass<I>::flush }... }};
+}
+constexpr auto size_class_ops = make_size_class_ops(std::make_index_sequence<SIZE_CLASS_COUNT>());
+
+/// @brief Blocks cached by a thread for each size class. Allocating and freeing
+/// a small block only touches this, so the common case takes no lock.
+struct ThreadCache {
+    struct Bin {
+        u32 count { 0 };
+        void* blocks[THREAD_CACHE_SIZE];
+    };
+    Bin bins[SIZE_CLASS_COUNT];
+
+    ~ThreadCache() {
+        for (usize i = 0; i < SIZE_CLASS_COUNT; i++) {
+            if (bins[i].count) {
+                size_class_ops[i].flush(bins[i].blocks, bins[i].count);
+                bins[i].count = 0;
+            }
+        }
+    }
+};
+
+thread_local ThreadCache thread_cache;
+
+/// @brief General purpose heap for anything too big or too aligned for the size classes
+Tlsf& large_heap() {
+    static Tlsf heap;
+    return heap;
+}
+
+std::mutex& large_heap_lock() {
+    static std::mutex lock;
+    return lock;
+}
+
+} // anonymous namespace
+
+/// @brief Allocate a block of memory and account it to a tag.
+/// Small requests come from per-thread caches over size-classed pools; larger or
+/// over-aligned ones from a TLSF heap, and huge ones straight from the system.
+/// @param size Size in bytes of the block
+/// @param alignment Alignment of the block. Must be a power of two
+/// @param memory_tag Tag to account the block to
+/// @return Pointer to the block. nullptr if out of memory or over the tag's hard budget
+void* allocate(usize size, usize alignment, tag memory_tag) {
+    if (!MemorySystem::reserve_tag(memory_tag, size)) {
+        return nullptr;
+    }
+
+    void* block;
+    if (size <= SMALL_ALLOCATION_MAX && alignment <= SMALL_ALIGNMENT) {
+        usize index = size_class(size);
+        ThreadCache::Bin& bin = thread_cache.bins[index];
+        if (bin.count == 0) {
+            bin.count = size_class_ops[index].refill(bin.blocks, THREAD_CACHE_SIZE / 2);
+        }
+        block = bin.blocks[--bin.count];
+    } else if (size <= Tlsf::BLOCK_SIZE_MAX) {
+        std::lock_guard<std::mutex> guard(large_heap_lock());
+        block = large_heap().allocate(size, alignment);
+    } else {
+        block = ::operator new(size, std::align_val_t(alignment), std::nothrow);
+    }
+
+    if (!block) {
+        MemorySystem::cancel_reservation(memory_tag, size);
+    } else if (AllocationTrace::recording()) {
+        AllocationTrace::record(TraceOp::ALLOCATE, block, size, alignment, memory_tag);
+    }
+    return block;
+}
+
+/// @brief Free a block returned by allocate()
+/// @param block Block to free
+/// @param size Size in bytes the block was allocated with
+/// @param alignment Alignment the block was allocated with
+/// @param memory_tag Tag the block was allocated with
+void free(void* block, usize size, usize alignment, tag memory_tag) {
+    if (!block) return;
+
+    if (AllocationTrace::recording()) {
+        AllocationTrace::record(TraceOp::FREE, block, size, alignment, memory_tag);
+    }
+
+    if (size <= SMALL_ALLOCATION_MAX && alignment <= SMALL_ALIGNMENT) {
+        usize index = size_class(size);
+        ThreadCache::Bin& bin = thread_cache.bins[index];
+        if (bin.count == THREAD_CACHE_SIZE) {
+            constexpr u32 half = THREAD_CACHE_SIZE / 2;
+            size_class_ops[index].flush(bin.blocks + half, half);
+            bin.count = half;
+        }
+        bin.blocks[bin.count++] = block;
+    } else if (size <= Tlsf::BLOCK_SIZE_MAX) {
+        std::lock_guard<std::mutex> guard(large_heap_lock());
+        large_heap().deallocate(block);
+    } else {
+        ::operator delete(block, std::align_val_t(alignment));
+    }
+
+    MemorySystem::decr_tag(memory_tag, size);
+}
+
+} // memory namespace
+} // gravity namespace
@@ -1,5 +1,14 @@
 #include "memory/memory.h"
+#include "memory/memory_resource.h"
+#include "memory/allocation_tracker.h"
+#include "memory/allocation_trace.h"
+#include "memory/relocatable_heap.h"
 #include "core/logger.h"
+#include "platform/platform.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
 
 namespace gravity {
 namespace memory {
@@ -7,6 +16,369 @@ using namespace core::logger;
 
 MemorySystem* MemorySystem::instance = nullptr;
 
+namespace {
+
+/// @brief Counters of one tag, kept together so an allocation touches a single cache line
+struct TagCounts {
+    std::atomic<i64> bytes { 0 };   // not yet flushed to tag_usage
+    std::atomic<u64> allocations { 0 };
+    std::atomic<u64> frees { 0 };
+};
+
+/// @brief Tag counters owned by a single thread.
+/// Only the owning thread writes to them, so updates are a plain load and store
+/// with no read-modify-write. Readers merge every block on demand.
+struct alignas(CACHE_LINE_SIZE) ThreadTagCounters {
+    TagCounts tags[tag::MAX_TAGS];
+
+    std::atomic<bool> in_use { false };
+    ThreadTagCounters* next { nullptr }; // registry link, never changes once published
+    u32 index { 0 };                     // dense id handed out through thread_index()
+};
+
+// Every counter block ever created. Blocks are never freed; when a thread exits its
+// block is handed to the next new thread so the registry only grows with peak thread count.
+std::atomic<ThreadTagCounters*> counters_head { nullptr };
+std::atomic<u32> counters_count { 0 };
+
+// Counts from threads that already handed their block back while exiting. Updated with
+// atomic adds, since any number of exiting threads can share it; never holds bytes.
+ThreadTagCounters exiting_counters;
+
+/// @brief Bytes of a tag flushed from the thread counters, on a cache line of its own
+struct alignas(CACHE_LINE_SIZE) SharedTagUsage {
+    std::atomic<i64> bytes { 0 };
+    std::atomic<usize> peak { 0 };
+};
+
+// A thread flushes its bytes for a tag here once TAG_FLUSH_BYTES have built up either way,
+// so small allocations never touch a shared line. Tags with a hard limit skip the batching
+// so their budget is checked against exact usage.
+constexpr i64 TAG_FLUSH_BYTES = 64 * 1024;
+SharedTagUsage tag_usage[tag::MAX_TAGS];
+
+/// @brief Claim a counter block for the calling thread
+ThreadTagCounters* acquire_counters() {
+    for (auto* c = counters_head.load(std::memory_order_acquire); c; c = c->next) {
+        bool expected = false;
+        if (c->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return c;
+        }
+    }
+
+    auto* c = new ThreadTagCounters();
+    c->in_use.store(true, std::memory_order_relaxed);
+    c->index = counters_count.fetch_add(1, std::memory_order_relaxed);
+    c->next = counters_head.load(std::memory_order_relaxed);
+    while (!counters_head.compare_exchange_weak(
+        c->next, c,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    )) {}
+
+    return c;
+}
+
+thread_local ThreadTagCounters* local_counters = nullptr;
+// Trivially destructible, so it stays readable while the thread's other thread_locals are destroyed
+thread_local bool counters_released = false;
+
+/// @brief Hands the thread's counter block back to the registry on thread exit.
+/// thread_local destructors that run after this one (scratch stacks, allocator
+/// caches) still free memory, so from here on the thread uses exiting_counters
+struct ThreadCountersRelease {
+    ThreadTagCounters* counters { nullptr };
+    ~ThreadCountersRelease() {
+        if (counters) {
+            local_counters = nullptr;
+            counters_released = true;
+            counters->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadCountersRelease local_counters_release;
+
+/// @return The calling thread's counter block. nullptr once it has been handed back on thread exit
+PINLINE ThreadTagCounters* thread_counters() {
+    if (!local_counters && !counters_released) {
+        local_counters = acquire_counters();
+        local_counters_release.counters = local_counters;
+    }
+    return local_counters;
+}
+
+/// @brief Visit every thread's counter block and the one shared by exiting threads
+template <typename FN>
+void for_each_counters(FN&& fn) {
+    for (auto* c = counters_head.load(std::memory_order_acquire); c; c = c->next) {
+        fn(*c);
+    }
+    fn(exiting_counters);
+}
+
+/// @brief Add to a counter that only the calling thread writes
+template <typename T, typename U>
+PINLINE void local_add(std::atomic<T>& counter, U amt) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + static_cast<T>(amt),
+        std::memory_order_relaxed
+    );
+}
+
+/// @brief Raise a tag's peak if `value` is higher
+void update_peak(tag memory_tag, usize value) {
+    usize peak = tag_usage[memory_tag].peak.load(std::memory_order_relaxed);
+    while (value > peak && !tag_usage[memory_tag].peak.compare_exchange_weak(
+        peak, value, std::memory_order_relaxed
+    )) {}
+}
+
+/// @brief Add bytes to a tag's shared counter and raise its peak from the result
+/// @return Bytes in the shared counter after the add
+i64 flush_bytes(tag memory_tag, i64 amt) {
+    i64 usage = tag_usage[memory_tag].bytes.fetch_add(amt, std::memory_order_relaxed) + amt;
+    if (amt > 0 && usage > 0) {
+        update_peak(memory_tag, static_cast<usize>(usage));
+    }
+    return usage;
+}
+
+constexpr const char* tag_names[] = {
+    "UNKNOWN",
+    "ARRAY",
+    "LINEAR_ALLOCATOR",
+    "DARRAY",
+    "DICT",
+    "RING_QUEUE",
+    "BST",
+    "STRING",
+    "ENGINE",
+    "JOB",
+    "TEXTURE",
+    "MATERIAL_INSTANCE",
+    "RENDERER",
+    "GAME",
+    "TRANSFORM",
+    "ENTITY",
+    "ENTITY_NODE",
+    "SCENE",
+    "RESOURCE",
+    "VULKAN",
+    "VULKAN_EXT",
+    "DIRECT3D",
+    "OPENGL",
+    "GPU_LOCAL",
+    "BITMAP_FONT",
+    "SYSTEM_FONT",
+    "KEYMAP",
+    "HASHTABLE",
+    "UI",
+    "AUDIO",
+    "REGISTRY",
+    "PLUGIN",
+    "STACK_ALLOCATOR",
+};
+static_assert(sizeof(tag_names) / sizeof(tag_names[0]) == tag::MAX_TAGS, "tag_names out of sync with memory::tag");
+
+/// @brief Scale a byte count into a human readable unit
+/// @param bytes Byte count to scale
+/// @param unit Out parameter for the unit suffix
+/// @return Scaled value
+f64 scale_bytes(usize bytes, const char*& unit) {
+    constexpr f64 KIB = 1024.0;
+    constexpr f64 MIB = KIB * 1024.0;
+    constexpr f64 GIB = MIB * 1024.0;
+
+    if (bytes >= GIB) { unit = "GiB"; return bytes / GIB; }
+    if (bytes >= MIB) { unit = "MiB"; return bytes / MIB; }
+    if (bytes >= KIB) { unit = "KiB"; return bytes / KIB; }
+    unit = "B";
+    return static_cast<f64>(bytes);
+}
+
+// Hard limits are checked against tag_usage, which is exact for tags that have one
+std::atomic<usize> soft_limits[tag::MAX_TAGS] {};
+std::atomic<usize> hard_limits[tag::MAX_TAGS] {};
+
+/// @brief Count `n` allocations or frees and `amt` bytes on the calling thread. Bytes are flushed to the
+/// shared counter once enough have built up, or straight away for hard-limited tags and exiting threads
+/// @param count TagCounts::allocations or TagCounts::frees
+PINLINE void account(tag memory_tag, std::atomic<u64> TagCounts::*count, u64 n, i64 amt) {
+    ThreadTagCounters* counters = thread_counters();
+    if (!counters) {
+        (exiting_counters.tags[memory_tag].*count).fetch_add(n, std::memory_order_relaxed);
+        flush_bytes(memory_tag, amt);
+        return;
+    }
+
+    TagCounts& counts = counters->tags[memory_tag];
+    local_add(counts.*count, n);
+    if (hard_limits[memory_tag].load(std::memory_order_relaxed)) {
+        if (amt) {
+            flush_bytes(memory_tag, amt);
+        }
+        return;
+    }
+
+    i64 pending = counts.bytes.load(std::memory_order_relaxed) + amt;
+    if (pending >= TAG_FLUSH_BYTES || pending <= -TAG_FLUSH_BYTES) {
+        counts.bytes.store(0, std::memory_order_relaxed);
+        flush_bytes(memory_tag, pending);
+    } else {
+        counts.bytes.store(pending, std::memory_order_relaxed);
+    }
+}
+bool over_soft_limit[tag::MAX_TAGS] {};  // only touched by begin_frame()
+std::atomic<u64> frame_index { 0 };                      // bumped by begin_frame()
+std::atomic<u64> refusal_logged_frame[tag::MAX_TAGS] {};  // frame_index + 1 when a hard limit refusal was last logged
+
+struct BudgetListener {
+    BudgetCallback callback;
+    void* user;
+};
+
+std::mutex budget_lock;
+BudgetListener budget_listeners[MAX_BUDGET_CALLBACKS] {};
+usize budget_listener_count = 0;
+thread_local bool in_budget_callback = false;
+
+/// @brief Run every budget callback
+void notify_budget(tag memory_tag, BudgetLimit limit, usize current, usize budget) {
+    // A callback that allocates from the tag it is trimming must not re-enter
+    if (in_budget_callback) {
+        return;
+    }
+
+    BudgetListener listeners[MAX_BUDGET_CALLBACKS];
+    usize count;
+    {
+        std::lock_guard<std::mutex> guard(budget_lock);
+        count = budget_listener_count;
+        std::copy(budget_listeners, budget_listeners + count, listeners);
+    }
+
+    in_budget_callback = true;
+    for (usize i = 0; i < count; i++) {
+        listeners[i].callback(memory_tag, limit, current, budget, listeners[i].user);
+    }
+    in_budget_callback = false;
+}
+
+/// @brief Warn about and notify every tag that is above its soft limit
+void check_soft_budgets(const TagStats (&stats)[tag::MAX_TAGS]) {
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        usize soft = soft_limits[i].load(std::memory_order_relaxed);
+        if (!soft || stats[i].current <= soft) {
+            over_soft_limit[i] = false;
+            continue;
+        }
+
+        if (!over_soft_limit[i]) {
+            Logger::get()->warn(
+                "MemorySystem: %s is over its soft budget (%zu of %zu bytes).",
+                tag_names[i],
+                stats[i].current,
+                soft
+            );
+            over_soft_limit[i] = true;
+        }
+        notify_budget(static_cast<tag>(i), BudgetLimit::SOFT, stats[i].current, soft);
+    }
+}
+
+
+/// @brief reserve_tag() for a tag with a hard limit. Kept out of line so the common unlimited path stays small
+PNOINLINE bool reserve_within_limit(tag memory_tag, usize amt, usize hard) {
+    // Claim the bytes first and check after, so racing allocators cannot all slip under the limit.
+    // A claim that gets rolled back can briefly make others see the tag fuller than it is; that only errs towards refusing
+    usize usage = 0;
+    for (u32 attempt = 0; attempt < 2; attempt++) {
+        i64 claimed = tag_usage[memory_tag].bytes.fetch_add(static_cast<i64>(amt), std::memory_order_relaxed) + static_cast<i64>(amt);
+        usage = claimed > 0 ? static_cast<usize>(claimed) : 0;
+        if (usage <= hard) {
+            account(memory_tag, &TagCounts::allocations, 1, 0);
+            update_peak(memory_tag, usage);
+            return true;
+        }
+        tag_usage[memory_tag].bytes.fetch_sub(static_cast<i64>(amt), std::memory_order_relaxed);
+
+        if (attempt == 0) {
+            // Give caches a chance to evict before refusing
+            notify_budget(memory_tag, BudgetLimit::HARD, usage, hard);
+        }
+    }
+
+    // One report per tag per frame; a tag pinned at its limit can refuse thousands of calls
+    u64 frame = frame_index.load(std::memory_order_relaxed) + 1;
+    if (refusal_logged_frame[memory_tag].exchange(frame, std::memory_order_relaxed) != frame) {
+        Logger::get()->error(
+            "MemorySystem: refusing %zu bytes for %s, hard budget is %zu bytes and %zu are in use. Further refusals this frame are not logged.",
+            amt,
+            tag_names[memory_tag],
+            hard,
+            usage - amt
+        );
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+/// @brief Get a printable name for a tag
+/// @param memory_tag Tag to get the name of
+/// @return Name of the tag
+const char* tag_name(tag memory_tag) {
+    if (memory_tag == tag::UNTRACKED) {
+        return "UNTRACKED";
+    }
+    if (memory_tag > tag::MAX_TAGS) {
+        return "INVALID";
+    }
+    return tag_names[memory_tag];
+}
+
+/// @brief Dense index of the calling thread. Indices of exited threads are reused,
+/// so the values stay below the peak number of threads alive at once.
+/// @return Index of the calling thread. EXITING_THREAD_INDEX once the thread has handed its index back
+u32 thread_index() {
+    ThreadTagCounters* counters = thread_counters();
+    return counters ? counters->index : EXITING_THREAD_INDEX;
+}
+
+void* allocate_slab(usize size) {
+    void* slab = platform::Platform::reserve_memory(size, size);
+    if (!slab) {
+        return nullptr;
+    }
+    if (!platform::Platform::commit_memory(slab, size)) {
+        platform::Platform::release_memory(slab, size);
+        return nullptr;
+    }
+    return slab;
+}
+
+void free_slab(void* slab, usize size) {
+    platform::Platform::release_memory(slab, size);
+}
+
+/// @brief Shared resource that allocates through memory::allocate and accounts to `memory_tag`
+/// @param memory_tag Tag to account allocations to
+/// @return Resource that lives for the whole program
+std::pmr::memory_resource* tagged_resource(tag memory_tag) {
+    static TaggedResource* resources = [] {
+        // Never destroyed: containers with static storage may free through these during exit
+        auto* r = static_cast<TaggedResource*>(::operator new(sizeof(TaggedResource) * tag::MAX_TAGS));
+        for (usize i = 0; i < tag::MAX_TAGS; i++) {
+            new (&r[i]) TaggedResource(static_cast<tag>(i));
+        }
+        return r;
+    }();
+
+    assert(memory_tag < tag::MAX_TAGS);
+    return &resources[memory_tag];
+}
+
 /// @brief Startup for memory subsystem
 /// @return true if successful false otherwise
 bool MemorySystem::startup() {
@@ -16,15 +388,14 @@ bool MemorySystem::startup() {
     }
 
     instance = new MemorySystem();
-    usize tags[tag::MAX_TAGS];
     instance->_state = {
         .is_initialized = true,
-        .tag_memory = {}
+        .frame_allocator = nullptr,
+        .frame_resource = nullptr,
     };
 
-    for (usize i = 0; i < tag::MAX_TAGS; i++) {
-        instance->_state.tag_memory[i] = 0;
-    }
+    instance->_state.frame_allocator = new LinearAllocator(FRAME_ALLOCATOR_SIZE);
+    instance->_state.frame_resource = new LinearAllocatorResource(*instance->_state.frame_allocator);
 
     return true;
 }
@@ -37,6 +408,8 @@ bool MemorySystem::shutdown() {
         return false;
     }
 
+    delete instance->_state.frame_resource;
+    delete instance->_state.frame_allocator;
     delete instance;
     instance = nullptr;
     return true;
@@ -57,20 +430,290 @@ MemorySystem* MemorySystem::get() {
 /// @param memory_tag tag we are allocating to
 /// @param amt the amount of bytes that were allocated
 void MemorySystem::incr_tag(tag memory_tag, usize amt) {
-    get()->_state.tag_memory[memory_tag] += amt;
+    if (memory_tag >= tag::MAX_TAGS) {
+        return;
+    }
+
+    account(memory_tag, &TagCounts::allocations, 1, static_cast<i64>(amt));
 }
 
 /// @brief decriment the amount of bytes that have been allocate for a tag
 /// @param memory_tag tag we are allocating to
 /// @param amt the amount of bytes that were allocated
 void MemorySystem::decr_tag(tag memory_tag, usize amt) {
-    get()->_state.tag_memory[memory_tag] -= amt;
+    if (memory_tag >= tag::MAX_TAGS) {
+        return;
+    }
+
+    account(memory_tag, &TagCounts::frees, 1, -static_cast<i64>(amt));
+}
+
+/// @brief Merge the counters of every thread for a single tag
+/// @param memory_tag Tag to collect
+/// @return Current stats for the tag
+TagStats MemorySystem::tag_stats(tag memory_tag) {
+    TagStats stats;
+    i64 bytes = tag_usage[memory_tag].bytes.load(std::memory_order_relaxed);
+    for_each_counters([&](ThreadTagCounters& c) {
+        bytes += c.tags[memory_tag].bytes.load(std::memory_order_relaxed);
+        stats.allocations += c.tags[memory_tag].allocations.load(std::memory_order_relaxed);
+        stats.frees += c.tags[memory_tag].frees.load(std::memory_order_relaxed);
+    });
+
+    // A flush racing with the merge can make the sum transiently negative
+    stats.current = bytes > 0 ? static_cast<usize>(bytes) : 0;
+    update_peak(memory_tag, stats.current);
+    stats.peak = tag_usage[memory_tag].peak.load(std::memory_order_relaxed);
+    return stats;
 }
 
-/// @brief Print info for each tag
+/// @brief Merge the counters of every thread for every tag
+/// @param stats Out array indexed by tag
+void MemorySystem::collect_stats(TagStats (&stats)[tag::MAX_TAGS]) {
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        stats[i] = {};
+    }
+
+    i64 bytes[tag::MAX_TAGS];
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        bytes[i] = tag_usage[i].bytes.load(std::memory_order_relaxed);
+    }
+
+    for_each_counters([&](ThreadTagCounters& c) {
+        for (usize i = 0; i < tag::MAX_TAGS; i++) {
+            bytes[i] += c.tags[i].bytes.load(std::memory_order_relaxed);
+            stats[i].allocations += c.tags[i].allocations.load(std::memory_order_relaxed);
+            stats[i].frees += c.tags[i].frees.load(std::memory_order_relaxed);
+        }
+    });
+
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        stats[i].current = bytes[i] > 0 ? static_cast<usize>(bytes[i]) : 0;
+        update_peak(static_cast<tag>(i), stats[i].current);
+        stats[i].peak = tag_usage[i].peak.load(std::memory_order_relaxed);
+    }
+}
+
+/// @brief Per-frame bookkeeping: checks soft budgets, closes the allocation tracker's frame, compacts relocatable heaps and resets the frame arena
+void MemorySystem::begin_frame() {
+    frame_index.fetch_add(1, std::memory_order_relaxed);
+    TagStats stats[tag::MAX_TAGS];
+    collect_stats(stats);
+    check_soft_budgets(stats);
+    AllocationTracker::next_frame();
+    if (AllocationTrace::recording()) {
+        AllocationTrace::record(TraceOp::FRAME, nullptr, 0, 1, tag::UNKNOWN);
+    }
+    RelocatableHeap::defragment_all();
+    reset_frame();
+}
+
+/// @brief Set the byte limits of a tag
+/// @param memory_tag Tag to limit
+/// @param soft Bytes above which callbacks are told once per frame. 0 for no limit
+/// @param hard Bytes allocations may not take the tag above. 0 for no limit
+void MemorySystem::set_budget(tag memory_tag, usize soft, usize hard) {
+    if (memory_tag >= tag::MAX_TAGS) {
+        return;
+    }
+
+    soft_limits[memory_tag].store(soft, std::memory_order_relaxed);
+    hard_limits[memory_tag].store(hard, std::memory_order_relaxed);
+}
+
+/// @brief Byte limits of a tag
+TagBudget MemorySystem::budget(tag memory_tag) {
+    if (memory_tag >= tag::MAX_TAGS) {
+        return {};
+    }
+    return {
+        soft_limits[memory_tag].load(std::memory_order_relaxed),
+        hard_limits[memory_tag].load(std::memory_order_relaxed),
+    };
+}
+
+/// @brief Register a function to call when a tag goes over budget
+/// @param callback Function to call
+/// @param user Passed back to the callback
+/// @return true if successful false if MAX_BUDGET_CALLBACKS are already registered
+bool MemorySystem::add_budget_callback(BudgetCallback callback, void* user) {
+    std::lock_guard<std::mutex> guard(budget_lock);
+    if (budget_listener_count == MAX_BUDGET_CALLBACKS) {
+        Logger::get()->error("MemorySystem: unable to add budget callback, %zu already registered.", MAX_BUDGET_CALLBACKS);
+        return false;
+    }
+
+    budget_listeners[budget_listener_count++] = { callback, user };
+    return true;
+}
+
+/// @brief Unregister a function added with add_budget_callback()
+void MemorySystem::remove_budget_callback(BudgetCallback callback, void* user) {
+    std::lock_guard<std::mutex> guard(budget_lock);
+    for (usize i = 0; i < budget_listener_count; i++) {
+        if (budget_listeners[i].callback == callback && budget_listeners[i].user == user) {
+            budget_listeners[i] = budget_listeners[--budget_listener_count];
+            return;
+        }
+    }
+}
+
+/// @brief Account bytes to a tag ahead of allocating them, unless that takes the tag over its hard limit
+/// @param memory_tag Tag the allocation is accounted to
+/// @param amt Size in bytes of the allocation
+/// @return true if the bytes were accounted. false, with nothing accounted, if they do not fit
+bool MemorySystem::reserve_tag(tag memory_tag, usize amt) {
+    if (memory_tag >= tag::MAX_TAGS) {
+        return true;
+    }
+    usize hard = hard_limits[memory_tag].load(std::memory_order_relaxed);
+    if (!hard) {
+        account(memory_tag, &TagCounts::allocations, 1, static_cast<i64>(amt));
+        return true;
+    }
+    return reserve_within_limit(memory_tag, amt, hard);
+}
+
+/// @brief Undo a successful reserve_tag() whose allocation then failed
+/// @param memory_tag Tag the reservation was made for
+/// @param amt Size in bytes of the reservation
+void MemorySystem::cancel_reservation(tag memory_tag, usize amt) {
+    if (memory_tag >= tag::MAX_TAGS) {
+        return;
+    }
+
+    account(memory_tag, &TagCounts::allocations, static_cast<u64>(-1), -static_cast<i64>(amt));
+}
+
+/// @brief Print current, peak and allocation count for each tag that has seen any use
 void MemorySystem::dump_info() {
-    // TODO:
+    TagStats stats[tag::MAX_TAGS];
+    collect_stats(stats);
+
+    usize total_current = 0;
+    Logger::get()->info("System memory use (tagged):");
+    Logger::get()->info("  %-18s %12s %12s %10s %10s", "TAG", "CURRENT", "PEAK", "ALLOCS", "FREES");
+    for (usize i = 0; i < tag::MAX_TAGS; i++) {
+        if (stats[i].peak == 0 && stats[i].allocations == 0) {
+            continue;
+        }
+
+        const char* current_unit;
+        const char* peak_unit;
+        f64 current = scale_bytes(stats[i].current, current_unit);
+        f64 peak = scale_bytes(stats[i].peak, peak_unit);
+        Logger::get()->info(
+            "  %-18s %8.2f %-3s %8.2f %-3s %10llu %10llu",
+            tag_names[i],
+            current, current_unit,
+            peak, peak_unit,
+            static_cast<unsigned long long>(stats[i].allocations),
+            static_cast<unsigned long long>(stats[i].frees)
+        );
+        total_current += stats[i].current;
+    }
+
+    const char* total_unit;
+    f64 total = scale_bytes(total_current, total_unit);
+    Logger::get()->info("  %-18s %8.2f %-3s", "TOTAL", total, total_unit);
+}
+
+/// @brief Create a linear allocator
+/// @param total_size Size in bytes of the backing block
+/// @param memory_tag Tag the backing block is accounted to
+LinearAllocator::LinearAllocator(usize total_size, tag memory_tag)
+    : _total_size(total_size)
+    , _allocated(0)
+    , _high_water(0)
+    , _tag(memory_tag)
+    , _memory(static_cast<u8*>(::operator new(total_size, std::align_val_t(alignof(std::max_align_t)))))
+{
+    MemorySystem::incr_tag(_tag, _total_size);
+}
+
+/// @brief Destroy the allocator and release its backing block
+LinearAllocator::~LinearAllocator() {
+    ::operator delete(_memory, std::align_val_t(alignof(std::max_align_t)));
+    MemorySystem::decr_tag(_tag, _total_size);
+}
+
+/// @brief Release every allocation made since the last reset
+void LinearAllocator::reset() {
+    _high_water = std::max(_high_water, _allocated);
+    _allocated = 0;
+}
+
+/// @brief Slow path for when an allocation does not fit in the remaining space
+/// @param size Size in bytes of the requested allocation
+/// @return nullptr
+void* LinearAllocator::_out_of_memory(usize size) {
+    Logger::get()->error(
+        "LinearAllocator: unable to allocate %zu bytes, only %zu of %zu remaining.",
+        size,
+        _total_size - _allocated,
+        _total_size
+    );
+    return nullptr;
+}
+
+/// @brief Create a stack allocator over a block of `total_size` bytes
+/// @param total_size Size in bytes of the backing block
+/// @param memory_tag Tag the backing block is accounted to
+StackAllocator::StackAllocator(usize total_size, tag memory_tag)
+    : _total_size(total_size)
+    , _allocated(0)
+    , _high_water(0)
+    , _tag(memory_tag)
+    , _memory(static_cast<u8*>(::operator new(total_size, std::align_val_t(alignof(std::max_align_t)))))
+{
+    MemorySystem::incr_tag(_tag, _total_size);
+}
+
+/// @brief Destroy the allocator and release its backing block
+StackAllocator::~StackAllocator() {
+    ::operator delete(_memory, std::align_val_t(alignof(std::max_align_t)));
+    MemorySystem::decr_tag(_tag, _total_size);
+}
+
+/// @brief Slow path for when an allocation does not fit in the remaining space
+/// @param size Size in bytes of the requested allocation
+/// @return nullptr
+void* StackAllocator::_out_of_memory(usize size) {
+    Logger::get()->error(
+        "StackAllocator: unable to allocate %zu bytes, only %zu of %zu remaining.",
+        size,
+        _total_size - _allocated,
+        _total_size
+    );
+    return nullptr;
+}
+
+#if defined(Q_DEBUG)
+/// @brief Check that `marker` is the innermost marker and poison the memory it releases
+/// @param marker Marker being popped
+void StackAllocator::_validate_pop(const Marker& marker) {
+    if (marker.depth + 1 != _depth || marker.offset > _allocated) {
+        Logger::get()->error(
+            "StackAllocator: marker %u popped out of order, %u markers are pushed.",
+            marker.depth,
+            _depth
+        );
+        assert(false && "StackAllocator markers must be popped in reverse order of push");
+    }
+    _depth = marker.depth;
+
+    // Anything still pointing into the released range reads garbage instead of stale data
+    if (marker.offset < _allocated) {
+        std::memset(_memory + marker.offset, 0xCD, _allocated - marker.offset);
+    }
+}
+#endif // Q_DEBUG
+
+/// @brief Scratch stack private to the calling thread, created on first use
+StackAllocator& MemorySystem::thread_stack() {
+    thread_local StackAllocator stack(THREAD_STACK_SIZE);
+    return stack;
 }
 
 } // memory namespace
-} // gravity namespace
\ No newline at end of file
+} // gravity namespace
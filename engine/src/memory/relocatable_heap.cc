@@ -0,0 +1,322 @@
+#include "memory/relocatable_heap.h"
+#include "core/logger.h"
+
+#include <cstring>
+
+namespace gravity {
+namespace memory {
+using namespace core::logger;
+
+RelocatableHeap* RelocatableHeap::_heaps = nullptr;
+
+/// @brief Reserve address space for the heap. Nothing is committed yet
+/// @param reserve_size Maximum size in bytes the heap can grow to
+/// @param memory_tag Tag committed memory is accounted to
+/// @param frame_budget Bytes moved by the compaction in each begin_frame(). 0 to only compact manually
+RelocatableHeap::RelocatableHeap(usize reserve_size, tag memory_tag, usize frame_budget)
+    : _blocks(reserve_size, memory_tag)
+    , _table((reserve_size / MIN_BLOCK_SIZE) * sizeof(Entry), memory_tag)
+    , _frame_budget(frame_budget)
+{
+    for (u32 i = 0; i < HOLE_BINS; i++) {
+        _bins[i] = NO_BLOCK;
+    }
+
+    _next = _heaps;
+    if (_heaps) {
+        _heaps->_prev = this;
+    }
+    _heaps = this;
+}
+
+/// @brief Release the heap. Every handle goes stale
+RelocatableHeap::~RelocatableHeap() {
+    if (_prev) {
+        _prev->_next = _next;
+    } else {
+        _heaps = _next;
+    }
+    if (_next) {
+        _next->_prev = _prev;
+    }
+}
+
+/// @brief Allocate a block
+/// @param size Size in bytes of the block
+/// @return Handle to the block. Invalid if the reservation is exhausted
+RelocatableHandle RelocatableHeap::allocate(usize size) {
+    usize block_size = std::max(
+        (size + HEADER_SIZE + (RELOCATABLE_ALIGNMENT - 1)) & ~(RELOCATABLE_ALIGNMENT - 1),
+        MIN_BLOCK_SIZE
+    );
+
+    u32 index = _free_entry;
+    if (index == HOLE && !_table.ensure_committed((_entry_count + 1) * sizeof(Entry))) {
+        Logger::get()->error("RelocatableHeap: out of handles.");
+        return {};
+    }
+
+    usize offset = _take_hole(block_size);
+    if (offset != NO_BLOCK) {
+        Header* header = _header(offset);
+        usize hole_size = header->units * RELOCATABLE_ALIGNMENT;
+        if (hole_size - block_size >= MIN_BLOCK_SIZE) {
+            header->units = block_size / RELOCATABLE_ALIGNMENT;
+            _insert_hole(offset + block_size, hole_size - block_size, block_size);
+        } else {
+            block_size = hole_size;
+        }
+    } else {
+        if (!_blocks.ensure_committed(_top + block_size)) {
+            Logger::get()->error("RelocatableHeap: unable to allocate %zu bytes.", size);
+            return {};
+        }
+        offset = _top;
+        Header* header = _header(offset);
+        header->prev_units = _last_units;
+        header->units = block_size / RELOCATABLE_ALIGNMENT;
+        _last_units = static_cast<u32>(header->units);
+        if (_first_hole == _top) {
+            _first_hole += block_size;
+        }
+        _top += block_size;
+    }
+
+    if (index != HOLE) {
+        _free_entry = _entries()[index].pins;
+    } else {
+        index = _entry_count++;
+        _entries()[index].generation = 0;
+    }
+
+    Entry& entry = _entries()[index];
+    entry.offset = offset;
+    entry.pins = 0;
+    entry.live = true;
+    _header(offset)->entry = index;
+    _live_bytes += block_size;
+    return { index, entry.generation };
+}
+
+/// @brief Free a block. Stale or invalid handles are ignored
+void RelocatableHeap::free(RelocatableHandle handle) {
+    Entry* entry = _entry(handle);
+    if (!entry) return;
+
+    usize offset = entry->offset;
+    usize size = _header(offset)->units * RELOCATABLE_ALIGNMENT;
+    _live_bytes -= size;
+
+    entry->live = false;
+    entry->generation++;
+    entry->pins = _free_entry;
+    _free_entry = handle.index;
+
+    // Merge with free neighbours so holes do not splinter
+    usize next = offset + size;
+    if (next < _top && _header(next)->entry == HOLE) {
+        size += _header(next)->units * RELOCATABLE_ALIGNMENT;
+        _remove_hole(next);
+    }
+    u32 prev_units = _header(offset)->prev_units;
+    if (prev_units) {
+        usize prev = offset - prev_units * RELOCATABLE_ALIGNMENT;
+        if (_header(prev)->entry == HOLE) {
+            _remove_hole(prev);
+            size += prev_units * RELOCATABLE_ALIGNMENT;
+            offset = prev;
+        }
+    }
+
+    if (offset + size == _top) {
+        _top = offset;
+        _last_units = _header(offset)->prev_units;
+        _first_hole = std::min(_first_hole, _top);
+    } else {
+        _insert_hole(offset, size, _header(offset)->prev_units * RELOCATABLE_ALIGNMENT);
+    }
+}
+
+/// @brief Usable size in bytes of a block. 0 for stale handles
+usize RelocatableHeap::size(RelocatableHandle handle) const {
+    const Entry* entry = _entry(handle);
+    return entry ? _header(entry->offset)->units * RELOCATABLE_ALIGNMENT - HEADER_SIZE : 0;
+}
+
+/// @brief Keep a block from moving until the matching unpin()
+void RelocatableHeap::pin(RelocatableHandle handle) {
+    if (Entry* entry = _entry(handle)) {
+        entry->pins++;
+    }
+}
+
+/// @brief Let a pinned block move again
+void RelocatableHeap::unpin(RelocatableHandle handle) {
+    Entry* entry = _entry(handle);
+    if (entry && entry->pins) {
+        entry->pins--;
+    }
+}
+
+/// @brief Slide live blocks down over holes
+/// @param budget Bytes to move before stopping. At least one block is moved if any can be
+/// @return Bytes moved
+usize RelocatableHeap::defragment(usize budget) {
+    if (_first_hole >= _top) {
+        return 0;
+    }
+
+    usize moved = 0;
+    usize src = _first_hole;
+    usize dst = _first_hole;
+    usize first_hole = NO_BLOCK;                  // first hole left behind a pinned block
+    u32 placed_units = _header(src)->prev_units;  // size of the block that ends at dst
+
+    while (src < _top) {
+        Header* header = _header(src);
+        u32 units = static_cast<u32>(header->units);
+        usize block_size = units * RELOCATABLE_ALIGNMENT;
+
+        if (header->entry == HOLE) {
+            _remove_hole(src);
+            src += block_size;
+            continue;
+        }
+
+        Entry& entry = _entries()[header->entry];
+        if (entry.pins) {
+            // Pinned blocks stay put; the space in front of them stays a hole
+            if (src != dst) {
+                _insert_hole(dst, src - dst, placed_units * RELOCATABLE_ALIGNMENT);
+                first_hole = std::min(first_hole, dst);
+            }
+            placed_units = units;
+            src += block_size;
+            dst = src;
+            continue;
+        }
+
+        if (src != dst) {
+            if (moved && moved + block_size > budget) {
+                break;
+            }
+            std::memmove(_base() + dst, _base() + src, block_size);
+            _header(dst)->prev_units = placed_units;
+            entry.offset = dst;
+            moved += block_size;
+        }
+        placed_units = units;
+        src += block_size;
+        dst += block_size;
+    }
+
+    if (src >= _top) {
+        _top = dst;
+        _last_units = placed_units;
+        _trim();
+    } else if (src != dst) {
+        _insert_hole(dst, src - dst, placed_units * RELOCATABLE_ALIGNMENT);
+    }
+    _first_hole = std::min(first_hole, dst);
+    return moved;
+}
+
+/// @brief Run each heap's per-frame compaction. Called from MemorySystem::begin_frame()
+void RelocatableHeap::defragment_all() {
+    for (RelocatableHeap* heap = _heaps; heap; heap = heap->_next) {
+        if (heap->_frame_budget) {
+            heap->defragment(heap->_frame_budget);
+        }
+        heap->_trim();
+    }
+}
+
+/// @brief Bin of a hole: the floor of log2 of its size
+u32 RelocatableHeap::_bin(usize size) {
+    u32 bin = 0;
+    while (bin + 1 < HOLE_BINS && (usize(2) << bin) <= size) {
+        bin++;
+    }
+    return bin;
+}
+
+/// @brief Turn a range into a hole and put it in its bin
+/// @param offset Start of the range
+/// @param size Size in bytes of the range
+/// @param prev_size Size in bytes of the block physically before the range
+void RelocatableHeap::_insert_hole(usize offset, usize size, usize prev_size) {
+    Header* header = _header(offset);
+    header->entry = HOLE;
+    header->prev_units = static_cast<u32>(prev_size / RELOCATABLE_ALIGNMENT);
+    header->units = size / RELOCATABLE_ALIGNMENT;
+
+    u32 bin = _bin(size);
+    HoleLinks* links = _links(offset);
+    links->next = _bins[bin];
+    links->prev = NO_BLOCK;
+    if (_bins[bin] != NO_BLOCK) {
+        _links(_bins[bin])->prev = offset;
+    }
+    _bins[bin] = offset;
+    _bin_bitmap |= u64(1) << bin;
+
+    if (offset + size < _top) {
+        _header(offset + size)->prev_units = static_cast<u32>(header->units);
+    }
+    _first_hole = std::min(_first_hole, offset);
+}
+
+/// @brief Take a hole out of its bin
+void RelocatableHeap::_remove_hole(usize offset) {
+    u32 bin = _bin(_header(offset)->units * RELOCATABLE_ALIGNMENT);
+    HoleLinks* links = _links(offset);
+    if (links->prev != NO_BLOCK) {
+        _links(links->prev)->next = links->next;
+    } else {
+        _bins[bin] = links->next;
+        if (links->next == NO_BLOCK) {
+            _bin_bitmap &= ~(u64(1) << bin);
+        }
+    }
+    if (links->next != NO_BLOCK) {
+        _links(links->next)->prev = links->prev;
+    }
+}
+
+/// @brief Find and unbin a hole of at least `size` bytes
+/// @return Offset of the hole. NO_BLOCK if none fits
+usize RelocatableHeap::_take_hole(usize size) {
+    u32 bin = _bin(size);
+
+    // Holes in the request's own bin may be too small, so only look at a few
+    usize hole = _bins[bin];
+    for (u32 i = 0; hole != NO_BLOCK && i < HOLE_SEARCH_LIMIT; i++) {
+        if (_header(hole)->units * RELOCATABLE_ALIGNMENT >= size) {
+            _remove_hole(hole);
+            return hole;
+        }
+        hole = _links(hole)->next;
+    }
+
+    // Any hole in a larger bin fits
+    u64 larger = bin + 1 < HOLE_BINS ? _bin_bitmap & ~((u64(2) << bin) - 1) : 0;
+    if (!larger) {
+        return NO_BLOCK;
+    }
+    u32 found = bin + 1;
+    while (!(larger & (u64(1) << found))) {
+        found++;
+    }
+    hole = _bins[found];
+    _remove_hole(hole);
+    return hole;
+}
+
+/// @brief Decommit pages past the top, keeping some slack so churn around the
+/// top does not commit and decommit every frame
+void RelocatableHeap::_trim() {
+    _blocks.trim(_top + _top / 4);
+}
+
+} // memory namespace
+} // gravity namespace
@@ -0,0 +1,347 @@
+#include "memory/tlsf.h"
+
+#include <bit>
+
+namespace gravity {
+namespace memory {
+
+/// @brief Header in front of every block. A block's payload starts right after `size`;
+/// the free list links are only valid while the block is free and live in the payload.
+struct Tlsf::Block {
+    Block* prev_phys;   // physically previous block. nullptr for the first block of a chunk
+    usize size;         // payload size in bytes. Low bit set while the block is free
+    Block* next_free;
+    Block* prev_free;
+};
+
+/// @brief Header at the start of every chunk requested from the system
+struct Tlsf::Chunk {
+    Chunk* next;
+    Chunk* prev;
+    usize bytes;
+    usize padding;
+};
+
+namespace {
+
+constexpr usize FREE_BIT = 1;
+constexpr usize HEADER_SIZE = 2 * sizeof(void*);
+constexpr usize BLOCK_SIZE_MIN = 2 * sizeof(void*);
+
+static_assert(HEADER_SIZE % TLSF_ALIGNMENT == 0, "Tlsf block header must keep payloads aligned");
+
+PINLINE usize align_up(usize n, usize a) { return (n + (a - 1)) & ~(a - 1); }
+PINLINE u32 fls(usize n) { return static_cast<u32>(std::bit_width(n)) - 1; }
+
+// Block helpers. Templates over the private Block type so they stay out of the public header.
+template <typename B> PINLINE usize block_size_of(const B* b) { return b->size & ~FREE_BIT; }
+template <typename B> PINLINE bool block_is_free(const B* b) { return (b->size & FREE_BIT) != 0; }
+template <typename B> PINLINE void block_set_free(B* b) { b->size |= FREE_BIT; }
+template <typename B> PINLINE void block_set_used(B* b) { b->size &= ~FREE_BIT; }
+template <typename B> PINLINE void block_set_size(B* b, usize size) { b->size = size | (b->size & FREE_BIT); }
+template <typename B> PINLINE void* block_payload(const B* b) {
+    return const_cast<u8*>(reinterpret_cast<const u8*>(b) + HEADER_SIZE);
+}
+template <typename B> PINLINE B* block_from_payload(const void* p) {
+    return reinterpret_cast<B*>(const_cast<u8*>(static_cast<const u8*>(p) - HEADER_SIZE));
+}
+template <typename B> PINLINE B* block_next_phys(const B* b) {
+    return reinterpret_cast<B*>(static_cast<u8*>(block_payload(b)) + block_size_of(b));
+}
+
+} // anonymous namespace
+
+/// @brief Create an allocator
+/// @param chunk_size Minimum size in bytes of each chunk requested from the system
+/// @param memory_tag Tag the chunks are accounted to
+Tlsf::Tlsf(usize chunk_size, tag memory_tag)
+    : _chunk_size(chunk_size)
+    , _tag(memory_tag)
+{}
+
+/// @brief Release every chunk
+Tlsf::~Tlsf() {
+    while (_chunks) {
+        _release_chunk(_chunks);
+    }
+}
+
+/// @brief Allocate a block
+/// @param size Size in bytes of the block
+/// @param alignment Alignment of the block. Must be a power of two
+/// @return Pointer to the block. nullptr if the system is out of memory
+void* Tlsf::allocate(usize size, usize alignment) {
+    if (size > BLOCK_SIZE_MAX) {
+        return nullptr;
+    }
+
+    size = std::max(align_up(size, TLSF_ALIGNMENT), BLOCK_SIZE_MIN);
+
+    // Over-aligned requests need room to carve off a free block in front of the
+    // aligned address, so ask for the worst case and trim afterwards
+    usize gap_min = HEADER_SIZE + BLOCK_SIZE_MIN;
+    usize request = alignment > TLSF_ALIGNMENT ? size + alignment + gap_min : size;
+
+    Block* block = _find_free(request);
+    if (!block) {
+        _add_chunk(request);
+        block = _find_free(request);
+        if (!block) {
+            return nullptr;
+        }
+    }
+
+    if (alignment > TLSF_ALIGNMENT) {
+        uintptr_t payload = reinterpret_cast<uintptr_t>(block_payload(block));
+        uintptr_t aligned = align_up(payload, alignment);
+        if (aligned != payload && aligned - payload < gap_min) {
+            aligned = align_up(payload + gap_min, alignment);
+        }
+
+        usize gap = aligned - payload;
+        if (gap) {
+            // Split the leading gap off as its own free block
+            Block* remaining = reinterpret_cast<Block*>(reinterpret_cast<u8*>(block) + gap);
+            remaining->prev_phys = block;
+            remaining->size = block_size_of(block) - gap;
+            block_next_phys(remaining)->prev_phys = remaining;
+
+            block->size = (gap - HEADER_SIZE) | FREE_BIT;
+            _insert_free(block);
+            block = remaining;
+        }
+    }
+
+    block = _split(block, size);
+    block_set_used(block);
+    _in_use += block_size_of(block);
+    return block_payload(block);
+}
+
+/// @brief Return a block to the allocator
+/// @param ptr Block returned by allocate()
+void Tlsf::deallocate(void* ptr) {
+    if (!ptr) return;
+
+    Block* block = block_from_payload<Block>(ptr);
+    assert(!block_is_free(block) && "Tlsf: double free");
+    _in_use -= block_size_of(block);
+
+    block_set_free(block);
+    block = _merge_prev(block);
+    block = _merge_next(block);
+
+    // A lone free block spanning its whole chunk means the chunk is unused
+    if (!block->prev_phys && block_size_of(block_next_phys(block)) == 0 && _chunk_count > 1) {
+        _release_chunk(reinterpret_cast<Chunk*>(reinterpret_cast<u8*>(block) - sizeof(Chunk)));
+        return;
+    }
+
+    _insert_free(block);
+}
+
+/// @brief Usable size in bytes of an allocated block. May be larger than requested
+/// @param ptr Block returned by allocate()
+/// @return Size in bytes
+usize Tlsf::block_size(const void* ptr) {
+    return block_size_of(block_from_payload<Block>(ptr));
+}
+
+/// @brief Request a chunk from the system and add it as one big free block
+/// @param min_payload Size in bytes the chunk must be able to satisfy
+void Tlsf::_add_chunk(usize min_payload) {
+    constexpr usize overhead = sizeof(Chunk) + (2 * HEADER_SIZE);
+
+    // _find_free() rounds requests up to the next second-level bin, so the new
+    // block has to be at least that big to be found
+    if (min_payload >= SMALL_BLOCK_SIZE) {
+        min_payload += (usize(1) << (fls(min_payload) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    usize payload = align_up(std::max(min_payload, _chunk_size > overhead ? _chunk_size - overhead : 0), TLSF_ALIGNMENT);
+    usize bytes = payload + overhead;
+
+    u8* memory = static_cast<u8*>(::operator new(bytes, std::align_val_t(TLSF_ALIGNMENT), std::nothrow));
+    if (!memory) {
+        return;
+    }
+
+    Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+    chunk->bytes = bytes;
+    chunk->prev = nullptr;
+    chunk->next = _chunks;
+    if (_chunks) {
+        _chunks->prev = chunk;
+    }
+    _chunks = chunk;
+
+    Block* block = reinterpret_cast<Block*>(memory + sizeof(Chunk));
+    block->prev_phys = nullptr;
+    block->size = payload | FREE_BIT;
+
+    // Zero sized, never free block that stops merges at the end of the chunk
+    Block* sentinel = block_next_phys(block);
+    sentinel->prev_phys = block;
+    sentinel->size = 0;
+
+    _insert_free(block);
+
+    _chunk_count += 1;
+    _reserved += bytes;
+    MemorySystem::incr_tag(_tag, bytes);
+}
+
+/// @brief Give a chunk back to the system. Its free block must not be in a free list
+/// @param chunk Chunk to release
+void Tlsf::_release_chunk(Chunk* chunk) {
+    if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+    } else {
+        _chunks = chunk->next;
+    }
+    if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+    }
+
+    usize bytes = chunk->bytes;
+    ::operator delete(static_cast<void*>(chunk), std::align_val_t(TLSF_ALIGNMENT));
+
+    _chunk_count -= 1;
+    _reserved -= bytes;
+    MemorySystem::decr_tag(_tag, bytes);
+}
+
+/// @brief Map a block size to its first and second level bin
+/// @param size Payload size in bytes
+/// @param fl Out first level index
+/// @param sl Out second level index
+void Tlsf::_mapping(usize size, u32& fl, u32& sl) {
+    if (size < SMALL_BLOCK_SIZE) {
+        fl = 0;
+        sl = static_cast<u32>(size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT));
+    } else {
+        u32 bit = fls(size);
+        sl = static_cast<u32>(size >> (bit - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+        fl = bit - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+/// @brief Push a free block onto the list of its size bin
+void Tlsf::_insert_free(Block* block) {
+    usize size = block_size_of(block);
+    u32 fl, sl;
+    _mapping(size, fl, sl);
+
+    Block* head = _free_lists[fl][sl];
+    block->next_free = head;
+    block->prev_free = nullptr;
+    if (head) {
+        head->prev_free = block;
+    }
+    _free_lists[fl][sl] = block;
+
+    _fl_bitmap |= (1u << fl);
+    _sl_bitmap[fl] |= (1u << sl);
+}
+
+/// @brief Unlink a free block from the list of its size bin
+void Tlsf::_remove_free(Block* block) {
+    usize size = block_size_of(block);
+    u32 fl, sl;
+    _mapping(size, fl, sl);
+
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        _free_lists[fl][sl] = block->next_free;
+        if (!block->next_free) {
+            _sl_bitmap[fl] &= ~(1u << sl);
+            if (!_sl_bitmap[fl]) {
+                _fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+    if (block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+}
+
+/// @brief Find and unlink a free block of at least `size` bytes
+/// @param size Payload size in bytes
+/// @return The block, or nullptr if no bin has one
+Tlsf::Block* Tlsf::_find_free(usize size) {
+    // Round up to the next bin so any block in it is big enough
+    if (size >= SMALL_BLOCK_SIZE) {
+        size += (usize(1) << (fls(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+
+    u32 fl, sl;
+    _mapping(size, fl, sl);
+    if (fl >= FL_INDEX_COUNT) {
+        return nullptr;
+    }
+
+    u32 sl_map = _sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        u32 fl_map = fl + 1 < 32 ? _fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) {
+            return nullptr;
+        }
+        fl = static_cast<u32>(std::countr_zero(fl_map));
+        sl_map = _sl_bitmap[fl];
+    }
+    sl = static_cast<u32>(std::countr_zero(sl_map));
+
+    Block* block = _free_lists[fl][sl];
+    _remove_free(block);
+    return block;
+}
+
+/// @brief Trim a block down to `size`, returning the tail to the free lists
+/// @param block Block that is not in a free list
+/// @param size Payload size to keep
+/// @return The trimmed block
+Tlsf::Block* Tlsf::_split(Block* block, usize size) {
+    usize block_size = block_size_of(block);
+    if (block_size < size + HEADER_SIZE + BLOCK_SIZE_MIN) {
+        return block;
+    }
+
+    Block* remainder = reinterpret_cast<Block*>(static_cast<u8*>(block_payload(block)) + size);
+    remainder->prev_phys = block;
+    remainder->size = (block_size - size - HEADER_SIZE) | FREE_BIT;
+    block_next_phys(remainder)->prev_phys = remainder;
+    block_set_size(block, size);
+
+    remainder = _merge_next(remainder);
+    _insert_free(remainder);
+    return block;
+}
+
+/// @brief Absorb the physically previous block if it is free
+Tlsf::Block* Tlsf::_merge_prev(Block* block) {
+    Block* prev = block->prev_phys;
+    if (!prev || !block_is_free(prev)) {
+        return block;
+    }
+
+    _remove_free(prev);
+    block_set_size(prev, block_size_of(prev) + HEADER_SIZE + block_size_of(block));
+    block_next_phys(prev)->prev_phys = prev;
+    return prev;
+}
+
+/// @brief Absorb the physically next block if it is free
+Tlsf::Block* Tlsf::_merge_next(Block* block) {
+    Block* next = block_next_phys(block);
+    if (!block_is_free(next)) {
+        return block;
+    }
+
+    _remove_free(next);
+    block_set_size(block, block_size_of(block) + HEADER_SIZE + block_size_of(next));
+    block_next_phys(block)->prev_phys = block;
+    return block;
+}
+
+} // memory namespace
+} // gravity namespace
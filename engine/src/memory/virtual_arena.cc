@@ -0,0 +1,75 @@
+#include "memory/virtual_arena.h"
+#include "platform/platform.h"
+#include "core/logger.h"
+
+namespace gravity {
+namespace memory {
+using namespace core::logger;
+
+/// @brief Reserve address space for the arena. Nothing is committed yet
+/// @param reserve_size Maximum size in bytes the arena can grow to
+/// @param memory_tag Tag committed memory is accounted to
+/// @param huge_pages Commit in huge page sized steps and ask for transparent huge pages
+VirtualArena::VirtualArena(usize reserve_size, tag memory_tag, bool huge_pages)
+    : _tag(memory_tag)
+    , _huge_pages(huge_pages)
+{
+    usize page = platform::Platform::page_size();
+    _commit_step = huge_pages ? HUGE_PAGE_SIZE : std::max(VIRTUAL_ARENA_COMMIT_SIZE, page);
+    _reserved = (reserve_size + (_commit_step - 1)) & ~(_commit_step - 1);
+
+    // Huge pages only back ranges aligned to the huge page size
+    _base = static_cast<u8*>(platform::Platform::reserve_memory(_reserved, huge_pages ? HUGE_PAGE_SIZE : 0));
+    if (!_base) {
+        Logger::get()->error("VirtualArena: unable to reserve %zu bytes of address space.", _reserved);
+        _reserved = 0;
+    }
+}
+
+/// @brief Release the reservation and every committed page
+VirtualArena::~VirtualArena() {
+    if (_base) {
+        platform::Platform::release_memory(_base, _reserved);
+        MemorySystem::decr_tag(_tag, _committed);
+    }
+}
+
+/// @brief Decommit pages past the current position
+/// @param keep Bytes to keep committed even if they are past the position
+void VirtualArena::trim(usize keep) {
+    usize needed = std::max(_position, keep);
+    usize boundary = (needed + (_commit_step - 1)) & ~(_commit_step - 1);
+    if (boundary >= _committed) {
+        return;
+    }
+
+    platform::Platform::decommit_memory(_base + boundary, _committed - boundary);
+    MemorySystem::decr_tag(_tag, _committed - boundary);
+    _committed = boundary;
+}
+
+/// @brief Commit pages so that the first `size` bytes are usable
+/// @param size Bytes from the start of the arena that must be committed
+/// @return true if successful false if the reservation or the tag's hard budget is exhausted
+bool VirtualArena::_commit_to(usize size) {
+    if (size > _reserved) {
+        Logger::get()->error("VirtualArena: %zu bytes requested but only %zu reserved.", size, _reserved);
+        return false;
+    }
+
+    usize target = (size + (_commit_step - 1)) & ~(_commit_step - 1);
+    if (!MemorySystem::reserve_tag(_tag, target - _committed)) {
+        return false;
+    }
+    if (!platform::Platform::commit_memory(_base + _committed, target - _committed, _huge_pages)) {
+        Logger::get()->error("VirtualArena: unable to commit %zu bytes.", target - _committed);
+        MemorySystem::cancel_reservation(_tag, target - _committed);
+        return false;
+    }
+
+    _committed = target;
+    return true;
+}
+
+} // memory namespace
+} // gravity namespace
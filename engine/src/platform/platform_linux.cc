@@ -5,6 +5,10 @@
 #include <string.h>
 
 #ifdef Q_PLATFORM_LINUX
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
 
 namespace qlogger {
 
@@ -77,4 +81,103 @@ void console_error(color msg_color, const std::string& msg) {
   
 } // gravity namespace
 
+namespace gravity {
+namespace platform {
+
+/// @brief Size in bytes of a virtual memory page
+usize Platform::page_size() {
+    static const usize size = static_cast<usize>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/// @brief Reserve a range of address space without backing it with memory
+/// @param size Size in bytes of the range. Rounded up to the page size
+/// @param alignment Alignment of the range. 0 for page alignment
+/// @return Start of the range. nullptr on failure
+void* Platform::reserve_memory(usize size, usize alignment) {
+    usize page = page_size();
+    size = (size + (page - 1)) & ~(page - 1);
+    usize padding = alignment > page ? alignment : 0;
+
+    void* mapping = mmap(nullptr, size + padding, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    if (!padding) {
+        return mapping;
+    }
+
+    // Over-reserve, then unmap whatever hangs off either side of the aligned range
+    uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+    uintptr_t aligned = (start + (alignment - 1)) & ~(alignment - 1);
+    if (aligned > start) {
+        munmap(mapping, aligned - start);
+    }
+    usize tail = (start + size + padding) - (aligned + size);
+    if (tail) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+/// @brief Back part of a reserved range with readable and writable memory
+/// @param address Page aligned start of the range to commit
+/// @param size Size in bytes to commit
+/// @param huge_pages Ask for transparent huge pages on the range
+/// @return true if successful false otherwise
+bool Platform::commit_memory(void* address, usize size, bool huge_pages) {
+    if (mprotect(address, size, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+        // Only a hint; the range still works with regular pages if THP is off
+        madvise(address, size, MADV_HUGEPAGE);
+    }
+#endif
+    return true;
+}
+
+/// @brief Return the pages of a committed range to the OS, keeping the address space reserved
+/// @param address Page aligned start of the range
+/// @param size Size in bytes of the range
+void Platform::decommit_memory(void* address, usize size) {
+    madvise(address, size, MADV_DONTNEED);
+    mprotect(address, size, PROT_NONE);
+}
+
+/// @brief Release a range returned by reserve_memory()
+/// @param address Start of the range
+/// @param size Size in bytes the range was reserved with
+void Platform::release_memory(void* address, usize size) {
+    usize page = page_size();
+    munmap(address, (size + (page - 1)) & ~(page - 1));
+}
+
+/// @brief Bytes of physical memory the process currently uses
+usize Platform::resident_memory() {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0;
+    }
+
+    unsigned long total = 0, resident = 0;
+    int read = fscanf(statm, "%lu %lu", &total, &resident);
+    fclose(statm);
+    return read == 2 ? static_cast<usize>(resident) * page_size() : 0;
+}
+
+/// @brief Most bytes of physical memory the process has used at once
+usize Platform::peak_resident_memory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // ru_maxrss is in kilobytes on Linux
+    return static_cast<usize>(usage.ru_maxrss) * 1024;
+}
+
+} // platform namespace
+} // gravity namespace
+
 #endif // Q_PLATFORM_LINUX
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #ifdef Q_PLATFORM_WINDOWS
 #include <windows.h>
+#include <psapi.h>
 #include <cstdint>
 namespace gravity {
 
@@ -114,11 +115,11 @@ void Platform::startup(const std::string& name, u32 width, u32 height) {
 	Platform::get()->clock_frequency = 1.0f / static_cast<double>(frequency.QuadPart);
 	QueryPerformanceCounter(&Platform::get()->start_time);
 
-    Platform::instance->_primary_window_name = name;
-    Platform::instance->_windows[name] = Window::create(width, height, name).unwrap();
-    Platform::instance->_primary_window = Platform::instance->_windows[name];
-    core::InputHandler::get()->register_window(Platform::instance->_windows[name]);
-    Platform::instance->_windows[name]->show();
+    Window* window = Window::create(width, height, name).unwrap();
+    Platform::instance->_window_names[core::StringId::intern(name)] = Platform::instance->_windows.insert(window);
+    Platform::instance->_primary_window = window;
+    core::InputHandler::get()->register_window(window);
+    window->show();
     std::vector<std::string> keys;
     
     core::logger::Logger::get()->debug("Startup platform <Win32> successful.");
@@ -126,9 +127,9 @@ void Platform::startup(const std::string& name, u32 width, u32 height) {
 
 /// @brief Pump messages to places that need it
 void Platform::pump_messages() {
-    for (const auto& window : Platform::get()->_windows) {
-        window.second->pump_messages();
-        window.second->draw_frame();
+    for (Window* window : Platform::get()->_windows) {
+        window->pump_messages();
+        window->draw_frame();
     }
 }
 
@@ -146,9 +147,9 @@ void Platform::shutdown() {
 /// @param hwnd handle to find by
 /// @return constant reference to the window
 Window* Platform::get_window_from_hwnd(HWND hwnd) {
-    for (auto it = _windows.begin(); it != _windows.end(); it++) {
-        if (it->second->get_handle().hwindow == hwnd) {
-            return it->second;
+    for (Window* window : _windows) {
+        if (window->get_handle().hwindow == hwnd) {
+            return window;
         }
     }
 
@@ -156,6 +157,88 @@ Window* Platform::get_window_from_hwnd(HWND hwnd) {
     exit(1);
 }
 
+/// @brief Size in bytes of a virtual memory page
+usize Platform::page_size() {
+    static const usize size = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<usize>(info.dwPageSize);
+    }();
+    return size;
+}
+
+/// @brief Reserve a range of address space without backing it with memory
+/// @param size Size in bytes of the range
+/// @param alignment Alignment of the range. 0 for the system allocation granularity
+/// @return Start of the range. nullptr on failure
+void* Platform::reserve_memory(usize size, usize alignment) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    if (alignment <= info.dwAllocationGranularity) {
+        return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+
+    // Windows cannot release part of a reservation, so find an aligned hole by
+    // over-reserving, then reserve again at the aligned address inside it
+    for (int attempt = 0; attempt < 8; attempt++) {
+        void* probe = VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+        if (!probe) {
+            return nullptr;
+        }
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(probe) + (alignment - 1)) & ~(alignment - 1);
+        VirtualFree(probe, 0, MEM_RELEASE);
+
+        void* result = VirtualAlloc(reinterpret_cast<void*>(aligned), size, MEM_RESERVE, PAGE_NOACCESS);
+        if (result) {
+            return result;
+        }
+    }
+    return nullptr;
+}
+
+/// @brief Back part of a reserved range with readable and writable memory
+/// @param address Start of the range to commit
+/// @param size Size in bytes to commit
+/// @param huge_pages Ignored. Large pages on Windows need a privilege and must be requested at reserve time
+/// @return true if successful false otherwise
+bool Platform::commit_memory(void* address, usize size, bool huge_pages) {
+    (void)huge_pages;
+    return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+/// @brief Return the pages of a committed range to the OS, keeping the address space reserved
+/// @param address Start of the range
+/// @param size Size in bytes of the range
+void Platform::decommit_memory(void* address, usize size) {
+    VirtualFree(address, size, MEM_DECOMMIT);
+}
+
+/// @brief Release a range returned by reserve_memory()
+/// @param address Start of the range
+/// @param size Unused. Windows releases the whole reservation
+void Platform::release_memory(void* address, usize size) {
+    (void)size;
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
+/// @brief Bytes of physical memory the process currently uses
+usize Platform::resident_memory() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return static_cast<usize>(counters.WorkingSetSize);
+}
+
+/// @brief Most bytes of physical memory the process has used at once
+usize Platform::peak_resident_memory() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return static_cast<usize>(counters.PeakWorkingSetSize);
+}
+
 } // platform namespace
 } // gravity namespace
 #endif // Q_PLATFORM_WINDOWS
\ No newline at end of file
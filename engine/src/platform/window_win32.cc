@@ -239,10 +239,8 @@ LRESULT CALLBACK Window::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPAR
 		case WM_CLOSE:
 		{
 			core::EventHandler::get()->post_event(
-				std::make_unique<core::ApplicationQuitEvent>(
-					core::ApplicationQuitEvent(
-						*Platform::get()->get_window_from_hwnd(hWnd)
-					)
+				core::ApplicationQuitEvent(
+					*Platform::get()->get_window_from_hwnd(hWnd)
 				),
 				true
 			);
@@ -292,7 +290,29 @@ LRESULT CALLBACK Window::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPAR
 		case WM_RBUTTONDOWN:
 		case WM_MBUTTONUP:
 		case WM_MBUTTONDOWN: {
-			// TODO: fire events for mouse buttons
+			bool pressed = (message == WM_LBUTTONDOWN || message == WM_RBUTTONDOWN || message == WM_MBUTTONDOWN);
+			MouseButtons button = MouseButtons::MAX_BUTTONS;
+			switch (message) {
+				case WM_LBUTTONUP:
+				case WM_LBUTTONDOWN:
+					button = MouseButtons::LEFT;
+					break;
+				case WM_RBUTTONUP:
+				case WM_RBUTTONDOWN:
+					button = MouseButtons::RIGHT;
+					break;
+				case WM_MBUTTONUP:
+				case WM_MBUTTONDOWN:
+					button = MouseButtons::MIDDLE;
+					break;
+			}
+
+			// Pass the input subsystem
+			core::InputHandler::get()->process_buttons(
+				button,
+				pressed,
+				Platform::get()->get_window_from_hwnd(hWnd)
+			);
 		} break;
 
 		case WM_SETFOCUS: {
@@ -110,7 +110,7 @@ void DXDescriptorHeap::process_deferred_free(u32 frame_index)
 {
     // std::lock_guard(_mutex);
     assert(frame_index < NUM_FRAMES);
-    std::vector<u32>& indices { _deferred_free_indices[frame_index] };
+    containers::DArray<u32>& indices { _deferred_free_indices[frame_index] };
     if (!indices.empty())
     {
         for (auto index: indices)
@@ -0,0 +1,5 @@
+#pragma once
+
+/// @brief Check that a steady-state EventHandler::poll_events() frame makes no heap allocations.
+/// Aborts on failure. Only meaningful in builds with allocation tracking (`scons track_allocations=1`)
+void check_poll_events_allocation_free() noexcept;
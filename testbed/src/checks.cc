@@ -0,0 +1,56 @@
+#include "checks.h"
+#include <core/events/events.h>
+#include <core/events/window_event.h>
+#include <core/logger.h>
+#include <memory/allocation_tracker.h>
+
+using namespace gravity;
+
+namespace {
+
+constexpr int WARMUP_FRAMES = 4;
+constexpr int EVENTS_PER_FRAME = 64;
+
+// Windows are only used as keys, so an aligned block stands in for one and the
+// synthetic events never reach the application's real window
+alignas(16) char window_storage[64];
+
+const platform::Window& dummy_window() {
+    return *reinterpret_cast<const platform::Window*>(window_storage);
+}
+
+bool on_resize(core::Event&, core::EventContext&) {
+    return true;
+}
+
+/// @brief Post a frame's worth of events and poll them
+void run_event_frame(core::EventHandler& handler) {
+    for (int i = 0; i < EVENTS_PER_FRAME; i++) {
+        handler.post_event(core::WindowResizeEvent(dummy_window(), 800, 600));
+    }
+    handler.poll_events();
+}
+
+} // anonymous namespace
+
+void check_poll_events_allocation_free() noexcept {
+    if (!memory::AllocationTracker::enabled()) {
+        core::logger::Logger::get()->info("Allocation tracking is off, skipping the poll_events() allocation check.");
+        return;
+    }
+
+    // A private handler keeps the check's callback and events out of the application's
+    core::EventHandler handler;
+    handler.register_callback(&dummy_window(), core::EventType::WINDOW_RESIZED, on_resize, "testbed");
+
+    // The first frames size the event buffers and scratch stack
+    for (int i = 0; i < WARMUP_FRAMES; i++) {
+        run_event_frame(handler);
+    }
+
+    {
+        memory::AllocationFreeScope scope("EventHandler::poll_events", memory::AllocationFreeMode::ASSERT);
+        run_event_frame(handler);
+    }
+    core::logger::Logger::get()->info("poll_events() is allocation free in steady state.");
+}
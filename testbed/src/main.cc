@@ -1,6 +1,7 @@
 #include <iostream>
 // #include "gravity.h"
 #include <core/application.h>
+#include "checks.h"
 
 
 
@@ -11,6 +12,8 @@ int main() noexcept {
         600
     );
 
+    check_poll_events_allocation_free();
+
     app->run();
     gravity::core::Application::shutdown();
 
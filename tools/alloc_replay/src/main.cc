@@ -0,0 +1,389 @@
+// Replays an allocation trace recorded with memory::AllocationTrace against
+// the engine allocators and malloc, and reports throughput, fragmentation and
+// peak RSS for each.
+//
+//   alloc_replay <trace> [malloc|allocator|pool|arena|all]
+//
+// Peak RSS is process wide, so run one backend per invocation when comparing it.
+#include <memory/memory.h>
+#include <memory/allocation_trace.h>
+#include <platform/platform.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace gravity;
+using memory::TraceOp;
+using memory::TraceRecord;
+using platform::Platform;
+
+namespace {
+
+constexpr usize MiB = 1024 * 1024;
+constexpr usize TOUCH_STRIDE = 4096;
+
+/// @brief A trace record with its block resolved to a slot, so the replay loop
+/// only indexes an array instead of looking addresses up
+struct ReplayOp {
+    TraceOp op;
+    memory::tag memory_tag;
+    u32 slot;
+    usize size;
+    usize alignment;
+};
+
+struct Workload {
+    std::vector<ReplayOp> ops;
+    std::vector<usize> live_at_end;  // indices of allocations that were never freed
+    u32 slot_count { 0 };
+    u64 allocations { 0 };
+    u64 frees { 0 };
+    u64 frames { 0 };
+    u64 unmatched_frees { 0 };       // blocks allocated before recording started
+    u64 cross_frame { 0 };           // allocations that outlived the frame they were made in
+    usize peak_live_bytes { 0 };
+    usize peak_live_index { 0 };     // op at which live bytes peaked
+    usize frame_peak_bytes { 0 };    // most bytes, with alignment padding, allocated in one frame
+};
+
+/// @brief Builds a Workload from the records of a trace
+struct Loader {
+    Workload& workload;
+    std::unordered_map<u64, usize> live;  // address -> index of the allocating op
+    std::vector<u32> free_slots;
+    std::vector<u64> slot_frame;
+    usize live_bytes { 0 };
+    usize frame_bytes { 0 };
+    u64 frame_live { 0 };
+
+    explicit Loader(Workload& workload) : workload(workload) {}
+
+    void free(usize index) {
+        ReplayOp op = workload.ops[index];
+        op.op = TraceOp::FREE;
+        live_bytes -= op.size;
+        if (slot_frame[op.slot] == workload.frames) {
+            frame_live--;
+        }
+        free_slots.push_back(op.slot);
+        workload.ops.push_back(op);
+        workload.frees++;
+    }
+
+    void add(const TraceRecord& record) {
+        switch (record.op) {
+        case TraceOp::ALLOCATE: {
+            auto it = live.find(record.address);
+            if (it != live.end()) {
+                // Threads are merged by timestamp, so a free on another thread can
+                // sort after the reuse of its address. Close the old block first.
+                free(it->second);
+                live.erase(it);
+            }
+
+            u32 slot;
+            if (free_slots.empty()) {
+                slot = workload.slot_count++;
+                slot_frame.push_back(0);
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            slot_frame[slot] = workload.frames;
+
+            live[record.address] = workload.ops.size();
+            workload.ops.push_back({ TraceOp::ALLOCATE, record.memory_tag, slot, record.size, record.alignment });
+            workload.allocations++;
+
+            live_bytes += record.size;
+            frame_bytes += record.size + record.alignment;
+            frame_live++;
+            if (live_bytes > workload.peak_live_bytes) {
+                workload.peak_live_bytes = live_bytes;
+                workload.peak_live_index = workload.ops.size() - 1;
+            }
+            break;
+        }
+        case TraceOp::FREE: {
+            auto it = live.find(record.address);
+            if (it == live.end()) {
+                workload.unmatched_frees++;
+                break;
+            }
+            free(it->second);
+            live.erase(it);
+            break;
+        }
+        case TraceOp::FRAME:
+            workload.ops.push_back({ TraceOp::FRAME, memory::tag::UNKNOWN, 0, 0, 0 });
+            workload.cross_frame += frame_live;
+            workload.frame_peak_bytes = std::max(workload.frame_peak_bytes, frame_bytes);
+            workload.frames++;
+            frame_bytes = 0;
+            frame_live = 0;
+            break;
+        }
+    }
+
+    void finish() {
+        workload.frame_peak_bytes = std::max(workload.frame_peak_bytes, frame_bytes);
+        for (auto& entry : live) {
+            workload.live_at_end.push_back(entry.second);
+        }
+    }
+};
+
+struct MallocBackend {
+    static constexpr const char* name = "malloc";
+
+    void* allocate(const ReplayOp& op) {
+        if (op.alignment <= alignof(std::max_align_t)) {
+            return std::malloc(op.size);
+        }
+        return ::operator new(op.size, std::align_val_t(op.alignment), std::nothrow);
+    }
+
+    void free(void* block, const ReplayOp& op) {
+        if (op.alignment <= alignof(std::max_align_t)) {
+            std::free(block);
+        } else {
+            ::operator delete(block, std::align_val_t(op.alignment));
+        }
+    }
+
+    void frame() {}
+};
+
+/// @brief memory::allocate/free: thread caches over size-classed pools and TLSF
+struct AllocatorBackend {
+    static constexpr const char* name = "allocator";
+
+    void* allocate(const ReplayOp& op) { return memory::allocate(op.size, op.alignment, op.memory_tag); }
+    void free(void* block, const ReplayOp& op) { memory::free(block, op.size, op.alignment, op.memory_tag); }
+    void frame() {}
+};
+
+/// @brief One growable Pool per power of two up to SMALL_ALLOCATION_MAX.
+/// Anything larger or more aligned falls back to malloc and is counted
+struct PoolBackend {
+    static constexpr const char* name = "pool";
+    static constexpr usize POOL_ALIGNMENT = 16;
+
+    memory::Pool<16, 256, POOL_ALIGNMENT> pool16 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<32, 256, POOL_ALIGNMENT> pool32 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<64, 256, POOL_ALIGNMENT> pool64 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<128, 256, POOL_ALIGNMENT> pool128 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<256, 256, POOL_ALIGNMENT> pool256 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<512, 256, POOL_ALIGNMENT> pool512 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    memory::Pool<1024, 256, POOL_ALIGNMENT> pool1024 { memory::tag::UNKNOWN, memory::PoolGrowth::GROW_AND_RELEASE };
+    MallocBackend fallback;
+    u64 fallbacks { 0 };
+
+    static u32 pool_index(usize size) {
+        u32 index = 0;
+        while ((static_cast<usize>(16) << index) < size) {
+            index++;
+        }
+        return index;
+    }
+
+    void* allocate(const ReplayOp& op) {
+        if (op.size > memory::SMALL_ALLOCATION_MAX || op.alignment > POOL_ALIGNMENT) {
+            fallbacks++;
+            return fallback.allocate(op);
+        }
+        switch (pool_index(op.size)) {
+        case 0: return pool16.allocate();
+        case 1: return pool32.allocate();
+        case 2: return pool64.allocate();
+        case 3: return pool128.allocate();
+        case 4: return pool256.allocate();
+        case 5: return pool512.allocate();
+        default: return pool1024.allocate();
+        }
+    }
+
+    void free(void* block, const ReplayOp& op) {
+        if (op.size > memory::SMALL_ALLOCATION_MAX || op.alignment > POOL_ALIGNMENT) {
+            fallback.free(block, op);
+            return;
+        }
+        switch (pool_index(op.size)) {
+        case 0: pool16.deallocate(block); break;
+        case 1: pool32.deallocate(block); break;
+        case 2: pool64.deallocate(block); break;
+        case 3: pool128.deallocate(block); break;
+        case 4: pool256.deallocate(block); break;
+        case 5: pool512.deallocate(block); break;
+        default: pool1024.deallocate(block); break;
+        }
+    }
+
+    void frame() {}
+};
+
+/// @brief Everything from a LinearAllocator that is reset at each frame marker.
+/// Frees are ignored, so this shows the cost if every allocation were frame scoped;
+/// the workload summary counts the allocations that would not survive that.
+struct ArenaBackend {
+    static constexpr const char* name = "arena";
+
+    memory::LinearAllocator arena;
+
+    explicit ArenaBackend(const Workload& workload)
+        : arena(std::max<usize>(workload.frame_peak_bytes, 1))
+    {}
+
+    void* allocate(const ReplayOp& op) { return arena.allocate(op.size, op.alignment); }
+    void free(void*, const ReplayOp&) {}
+    void frame() { arena.reset(); }
+};
+
+template <typename BACKEND>
+void replay(BACKEND& backend, const Workload& workload) {
+    std::vector<void*> slots(workload.slot_count, nullptr);
+    u64 failures = 0;
+
+    usize resident_before = Platform::resident_memory();
+    usize resident_at_peak = resident_before;
+    auto start = std::chrono::steady_clock::now();
+
+    const ReplayOp* ops = workload.ops.data();
+    for (usize i = 0; i < workload.ops.size(); i++) {
+        const ReplayOp& op = ops[i];
+        switch (op.op) {
+        case TraceOp::ALLOCATE: {
+            u8* block = static_cast<u8*>(backend.allocate(op));
+            slots[op.slot] = block;
+            if (!block) {
+                failures++;
+                break;
+            }
+            // Touch every page like the real caller would, so resident memory is comparable
+            for (usize offset = 0; offset < op.size; offset += TOUCH_STRIDE) {
+                block[offset] = 0;
+            }
+            if (i == workload.peak_live_index) {
+                resident_at_peak = Platform::resident_memory();
+            }
+            break;
+        }
+        case TraceOp::FREE:
+            if (slots[op.slot]) {
+                backend.free(slots[op.slot], op);
+                slots[op.slot] = nullptr;
+            }
+            break;
+        case TraceOp::FRAME:
+            backend.frame();
+            break;
+        }
+    }
+
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    for (usize index : workload.live_at_end) {
+        const ReplayOp& op = ops[index];
+        if (slots[op.slot]) {
+            backend.free(slots[op.slot], op);
+        }
+    }
+
+    usize ops_count = workload.allocations + workload.frees;
+    usize footprint = resident_at_peak > resident_before ? resident_at_peak - resident_before : 0;
+    std::printf(
+        "%-10s %10.2f Mops/s %8.1f ns/op   footprint at peak %9.2f MiB (%5.2fx live)   peak RSS %9.2f MiB",
+        BACKEND::name,
+        seconds > 0 ? ops_count / seconds / 1e6 : 0.0,
+        ops_count ? seconds * 1e9 / ops_count : 0.0,
+        static_cast<f64>(footprint) / MiB,
+        workload.peak_live_bytes ? static_cast<f64>(footprint) / workload.peak_live_bytes : 0.0,
+        static_cast<f64>(Platform::peak_resident_memory()) / MiB
+    );
+    if (failures) {
+        std::printf("   %llu failed", static_cast<unsigned long long>(failures));
+    }
+    std::printf("\n");
+}
+
+void usage() {
+    std::fprintf(stderr, "usage: alloc_replay <trace> [malloc|allocator|pool|arena|all]\n");
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    const char* backend = argc > 2 ? argv[2] : "all";
+    bool all = std::strcmp(backend, "all") == 0;
+
+    Workload workload;
+    {
+        Loader loader(workload);
+        bool valid = memory::AllocationTrace::read(argv[1], [](const TraceRecord& record, void* user) {
+            static_cast<Loader*>(user)->add(record);
+        }, &loader);
+        if (!valid) {
+            std::fprintf(stderr, "alloc_replay: %s is not a complete allocation trace\n", argv[1]);
+            if (workload.ops.empty()) {
+                return EXIT_FAILURE;
+            }
+        }
+        loader.finish();
+    }
+
+    std::printf(
+        "%llu allocations, %llu frees, %llu frames, peak live %.2f MiB, peak per frame %.2f MiB\n",
+        static_cast<unsigned long long>(workload.allocations),
+        static_cast<unsigned long long>(workload.frees),
+        static_cast<unsigned long long>(workload.frames),
+        static_cast<f64>(workload.peak_live_bytes) / MiB,
+        static_cast<f64>(workload.frame_peak_bytes) / MiB
+    );
+    std::printf(
+        "%llu allocations outlive their frame, %llu frees of blocks allocated before recording\n\n",
+        static_cast<unsigned long long>(workload.cross_frame),
+        static_cast<unsigned long long>(workload.unmatched_frees)
+    );
+
+    memory::MemorySystem::startup();
+
+    bool ran = false;
+    if (all || std::strcmp(backend, MallocBackend::name) == 0) {
+        MallocBackend b;
+        replay(b, workload);
+        ran = true;
+    }
+    if (all || std::strcmp(backend, AllocatorBackend::name) == 0) {
+        AllocatorBackend b;
+        replay(b, workload);
+        ran = true;
+    }
+    if (all || std::strcmp(backend, PoolBackend::name) == 0) {
+        PoolBackend b;
+        replay(b, workload);
+        std::printf("%-10s %llu allocations too large or too aligned for a pool went to malloc\n",
+            "", static_cast<unsigned long long>(b.fallbacks));
+        ran = true;
+    }
+    if (all || std::strcmp(backend, ArenaBackend::name) == 0) {
+        ArenaBackend b(workload);
+        replay(b, workload);
+        ran = true;
+    }
+
+    memory::MemorySystem::shutdown();
+
+    if (!ran) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+// Compares memory::allocate/free with malloc/free. Each run keeps LIVE_BLOCKS
+// blocks live and replaces a pseudo-random one per operation, so free lists and
+// caches see a steady alloc/free mix. Fixed sizes cover the size-classed pools
+// (up to SMALL_ALLOCATION_MAX) and the TLSF heap above them; the mixed rows draw
+// a new size for every allocation. Mixed small sizes are also run on 1..N threads.
+// Every figure is the best of REPEATS runs.
+//
+//   allocator_bench [max_threads] [ops]
+#include <memory/memory.h>
+#include <core/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace gravity;
+
+namespace {
+
+constexpr usize LIVE_BLOCKS = 1024;
+constexpr usize ALIGNMENT = 16;
+constexpr u32 REPEATS = 3;
+
+/// @brief Sizes of one workload row. A range draws a size per allocation from [min_size, max_size]
+struct Workload {
+    const char* name;
+    usize min_size;
+    usize max_size;
+};
+
+constexpr Workload WORKLOADS[] = {
+    { "16 B", 16, 16 },
+    { "64 B", 64, 64 },
+    { "256 B", 256, 256 },
+    { "1 KiB", 1024, 1024 },
+    { "4 KiB", 4096, 4096 },
+    { "64 KiB", 65536, 65536 },
+    { "mixed 8 B-1 KiB", 8, 1024 },
+    { "mixed 8 B-16 KiB", 8, 16384 },
+};
+
+/// @brief Slot to replace and size to allocate for every operation, drawn up front so the timed loop is only the allocator
+struct Ops {
+    std::vector<u32> slots;
+    std::vector<u32> sizes;
+};
+
+Ops make_ops(const Workload& workload, u64 count, u64 seed) {
+    Ops ops;
+    ops.slots.resize(count);
+    ops.sizes.resize(count);
+    u64 state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (u64 i = 0; i < count; i++) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ops.slots[i] = static_cast<u32>(state % LIVE_BLOCKS);
+        ops.sizes[i] = static_cast<u32>(workload.min_size + (state >> 32) % (workload.max_size - workload.min_size + 1));
+    }
+    return ops;
+}
+
+/// @brief Replay `ops` against an allocator
+template <typename ALLOC, typename FREE>
+void replay(const Ops& ops, ALLOC&& alloc, FREE&& release) {
+    void* live[LIVE_BLOCKS] = {};
+    usize live_sizes[LIVE_BLOCKS] = {};
+    for (usize i = 0; i < ops.slots.size(); i++) {
+        u32 slot = ops.slots[i];
+        if (live[slot]) {
+            release(live[slot], live_sizes[slot]);
+        }
+        live[slot] = alloc(ops.sizes[i]);
+        if (!live[slot]) {
+            std::fprintf(stderr, "allocator_bench: allocation failed\n");
+            std::abort();
+        }
+        live_sizes[slot] = ops.sizes[i];
+        *static_cast<u8*>(live[slot]) = static_cast<u8>(i);
+    }
+    for (usize slot = 0; slot < LIVE_BLOCKS; slot++) {
+        if (live[slot]) {
+            release(live[slot], live_sizes[slot]);
+        }
+    }
+}
+
+/// @brief Replay a copy of `ops` on each of `threads` threads, REPEATS times
+/// @return Nanoseconds of wall time per alloc/free pair over all threads, from the fastest run
+template <typename ALLOC, typename FREE>
+f64 run(u32 threads, const Ops& ops, ALLOC&& alloc, FREE&& release) {
+    f64 best = 0.0;
+    for (u32 repeat = 0; repeat < REPEATS; repeat++) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (u32 t = 0; t < threads; t++) {
+            workers.emplace_back([&] { replay(ops, alloc, release); });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+        f64 ns = seconds * 1e9 / (static_cast<f64>(threads) * static_cast<f64>(ops.slots.size()));
+        best = repeat == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+f64 run_engine(u32 threads, const Ops& ops) {
+    return run(threads, ops,
+        [](usize size) { return memory::allocate(size, ALIGNMENT, memory::tag::GAME); },
+        [](void* block, usize size) { memory::free(block, size, ALIGNMENT, memory::tag::GAME); });
+}
+
+f64 run_malloc(u32 threads, const Ops& ops) {
+    return run(threads, ops,
+        [](usize size) { return std::malloc(size); },
+        [](void* block, usize) { std::free(block); });
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 max_threads = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+    u64 count = argc > 2 ? static_cast<u64>(std::atoll(argv[2])) : 2'000'000;
+
+    // No Platform is started, so there is no console to log to
+    core::logger::Logger::startup();
+    core::logger::Logger::get()->use_console(false);
+    memory::MemorySystem::startup();
+
+    std::printf("%llu alloc/free pairs, %zu blocks live, %zu byte alignment   (ns per pair)\n",
+        static_cast<unsigned long long>(count), LIVE_BLOCKS, ALIGNMENT);
+    std::printf("%-18s %18s %12s %10s\n", "SIZE", "MEMORY::ALLOCATE", "MALLOC", "SPEEDUP");
+    for (const Workload& workload : WORKLOADS) {
+        Ops ops = make_ops(workload, count, 1);
+        f64 engine = run_engine(1, ops);
+        f64 system = run_malloc(1, ops);
+        std::printf("%-18s %18.1f %12.1f %9.2fx\n", workload.name, engine, system, system / engine);
+    }
+
+    const Workload& mixed = WORKLOADS[6];
+    Ops ops = make_ops(mixed, count, 2);
+    std::printf("%s on 1..%u threads   (ns of wall time per pair)\n", mixed.name, max_threads);
+    std::printf("%-18s %18s %12s %10s\n", "THREADS", "MEMORY::ALLOCATE", "MALLOC", "SPEEDUP");
+    for (u32 threads = 1; threads <= max_threads; threads *= 2) {
+        f64 engine = run_engine(threads, ops);
+        f64 system = run_malloc(threads, ops);
+        std::printf("%-18u %18.1f %12.1f %9.2fx\n", threads, engine, system, system / engine);
+    }
+
+    // Every block was freed, so anything left on the tag means the accounting is broken
+    memory::TagStats stats = memory::MemorySystem::tag_stats(memory::tag::GAME);
+    if (stats.current != 0 || stats.allocations != stats.frees) {
+        std::fprintf(stderr, "allocator_bench: %zu bytes still accounted to GAME\n", stats.current);
+        return EXIT_FAILURE;
+    }
+
+    memory::MemorySystem::shutdown();
+    core::logger::Logger::shutdown();
+    return EXIT_SUCCESS;
+}
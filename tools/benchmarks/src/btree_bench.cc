@@ -0,0 +1,174 @@
+// Compares containers::BTree and containers::FlatMap with std::map on u64 keys:
+// random inserts, lookup hits, full scans, 100-element range scans and erases.
+//
+//   btree_bench [max_elements]
+#include <containers/btree.h>
+#include <containers/flat_map.h>
+#include <core/logger.h>
+#include <memory/memory.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace gravity;
+
+namespace {
+
+constexpr usize LOOKUPS = 1 << 18;
+constexpr usize RANGES = 1000;
+constexpr usize RANGE_SPAN = 100;
+
+volatile u64 sink;
+
+/// @brief Run `body` `repeats` times
+/// @return Nanoseconds per run
+template <typename BODY>
+f64 time_ns(u32 repeats, BODY&& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < repeats; i++) {
+        body();
+    }
+    return std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+void run(usize n) {
+    std::mt19937_64 random(1);
+    std::vector<u64> keys(n);
+    for (u64& key : keys) {
+        key = random();
+    }
+    std::vector<u64> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<u64> lookups(LOOKUPS);
+    for (u64& key : lookups) {
+        key = keys[random() % n];
+    }
+    usize span = std::min(RANGE_SPAN, n / 2);
+
+    f64 insert_btree = time_ns(1, [&] {
+        containers::BTree<u64, u64> tree;
+        for (u64 key : keys) {
+            tree.try_emplace(key, key);
+        }
+        sink = tree.size();
+    }) / n;
+    f64 insert_map = time_ns(1, [&] {
+        std::map<u64, u64> map;
+        for (u64 key : keys) {
+            map.try_emplace(key, key);
+        }
+        sink = map.size();
+    }) / n;
+
+    containers::BTree<u64, u64> tree;
+    std::map<u64, u64> map;
+    containers::FlatMap<u64, u64> flat;
+    for (u64 key : keys) {
+        tree.try_emplace(key, key);
+        map.try_emplace(key, key);
+    }
+    flat.reserve(n);
+    for (u64 key : sorted) {
+        flat.try_emplace(key, key);
+    }
+
+    f64 find_btree = time_ns(3, [&] {
+        u64 sum = 0;
+        for (u64 key : lookups) sum += tree.find(key).value();
+        sink = sum;
+    }) / LOOKUPS;
+    f64 find_map = time_ns(3, [&] {
+        u64 sum = 0;
+        for (u64 key : lookups) sum += map.find(key)->second;
+        sink = sum;
+    }) / LOOKUPS;
+    f64 find_flat = time_ns(3, [&] {
+        u64 sum = 0;
+        for (u64 key : lookups) sum += flat.find(key).value();
+        sink = sum;
+    }) / LOOKUPS;
+
+    f64 scan_btree = time_ns(3, [&] {
+        u64 sum = 0;
+        for (auto [key, value] : tree) sum += value;
+        sink = sum;
+    }) / n;
+    f64 scan_map = time_ns(3, [&] {
+        u64 sum = 0;
+        for (auto& entry : map) sum += entry.second;
+        sink = sum;
+    }) / n;
+    f64 scan_flat = time_ns(3, [&] {
+        u64 sum = 0;
+        for (auto [key, value] : flat) sum += value;
+        sink = sum;
+    }) / n;
+
+    auto range_start = [&](usize i) { return (i * 7919) % (n - span); };
+    f64 range_btree = time_ns(3, [&] {
+        u64 sum = 0;
+        for (usize i = 0; i < RANGES; i++) {
+            usize first = range_start(i);
+            for (auto [key, value] : tree.range(sorted[first], sorted[first + span])) sum += value;
+        }
+        sink = sum;
+    }) / RANGES;
+    f64 range_map = time_ns(3, [&] {
+        u64 sum = 0;
+        for (usize i = 0; i < RANGES; i++) {
+            usize first = range_start(i);
+            auto end = map.lower_bound(sorted[first + span]);
+            for (auto it = map.lower_bound(sorted[first]); it != end; ++it) sum += it->second;
+        }
+        sink = sum;
+    }) / RANGES;
+    f64 range_flat = time_ns(3, [&] {
+        u64 sum = 0;
+        for (usize i = 0; i < RANGES; i++) {
+            usize first = range_start(i);
+            for (auto [key, value] : flat.range(sorted[first], sorted[first + span])) sum += value;
+        }
+        sink = sum;
+    }) / RANGES;
+
+    f64 erase_btree = time_ns(1, [&] {
+        for (usize i = 0; i < n; i += 2) tree.erase(keys[i]);
+        sink = tree.size();
+    }) / (n / 2);
+    f64 erase_map = time_ns(1, [&] {
+        for (usize i = 0; i < n; i += 2) map.erase(keys[i]);
+        sink = map.size();
+    }) / (n / 2);
+
+    std::printf("%-9zu %-10s %12.1f %12.1f %12s\n", n, "insert", insert_btree, insert_map, "-");
+    std::printf("%-9s %-10s %12.1f %12.1f %12.1f\n", "", "find", find_btree, find_map, find_flat);
+    std::printf("%-9s %-10s %12.2f %12.2f %12.2f\n", "", "scan/elem", scan_btree, scan_map, scan_flat);
+    std::printf("%-9s %-10s %12.0f %12.0f %12.0f\n", "", "range100", range_btree, range_map, range_flat);
+    std::printf("%-9s %-10s %12.1f %12.1f %12s\n", "", "erase", erase_btree, erase_map, "-");
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    usize max_elements = argc > 1 ? static_cast<usize>(std::atoll(argv[1])) : 1'000'000;
+
+    // No Platform is started, so there is no console to log to
+    core::logger::Logger::startup();
+    core::logger::Logger::get()->use_console(false);
+    memory::MemorySystem::startup();
+
+    std::printf("ns per operation; FlatMap is built from sorted keys, so insert/erase are not measured for it\n");
+    std::printf("%-9s %-10s %12s %12s %12s\n", "ELEMENTS", "OP", "BTREE", "STD::MAP", "FLATMAP");
+    for (usize n = 1000; n <= max_elements; n *= 10) {
+        run(n);
+    }
+
+    memory::MemorySystem::shutdown();
+    core::logger::Logger::shutdown();
+    return EXIT_SUCCESS;
+}
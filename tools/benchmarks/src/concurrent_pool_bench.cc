@@ -0,0 +1,97 @@
+// Compares memory::ConcurrentPool with a mutex-guarded memory::Pool and malloc
+// at 1..N threads. Each thread keeps LIVE_BLOCKS blocks live and replaces one
+// per operation, so caches and free lists see a steady alloc/free mix.
+//
+//   concurrent_pool_bench [max_threads] [ops_per_thread]
+#include <memory/memory.h>
+#include <memory/concurrent_pool.h>
+#include <core/logger.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace gravity;
+
+namespace {
+
+constexpr usize BLOCK_SIZE = 64;
+constexpr usize POOL_BLOCKS = 1 << 16;
+constexpr usize LIVE_BLOCKS = 64;
+
+/// @brief Run `threads` threads of `ops` alloc/free pairs each
+/// @return Millions of alloc/free pairs per second over all threads
+template <typename ALLOC, typename FREE>
+f64 run(u32 threads, u64 ops, ALLOC&& alloc, FREE&& release) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (u32 t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            void* live[LIVE_BLOCKS] = {};
+            for (u64 i = 0; i < ops; i++) {
+                void*& slot = live[i % LIVE_BLOCKS];
+                if (slot) {
+                    release(slot);
+                }
+                slot = alloc();
+                if (!slot) {
+                    std::fprintf(stderr, "concurrent_pool_bench: allocation failed\n");
+                    std::abort();
+                }
+                *static_cast<u64*>(slot) = i;
+            }
+            for (void* block : live) {
+                if (block) {
+                    release(block);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<f64>(threads) * static_cast<f64>(ops) / seconds / 1e6;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 max_threads = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+    u64 ops = argc > 2 ? static_cast<u64>(std::atoll(argv[2])) : 2'000'000;
+
+    // No Platform is started, so there is no console to log to
+    core::logger::Logger::startup();
+    core::logger::Logger::get()->use_console(false);
+    memory::MemorySystem::startup();
+
+    {
+        memory::ConcurrentPool<BLOCK_SIZE, POOL_BLOCKS> concurrent_pool;
+        memory::Pool<BLOCK_SIZE, POOL_BLOCKS> pool;
+        std::mutex pool_lock;
+
+        std::printf("%llu alloc/free pairs per thread, %zu blocks of %zu bytes live per thread\n",
+            static_cast<unsigned long long>(ops), LIVE_BLOCKS, BLOCK_SIZE);
+        std::printf("%-8s %16s %16s %16s   (M pairs/s)\n", "THREADS", "CONCURRENTPOOL", "POOL+MUTEX", "MALLOC");
+        for (u32 threads = 1; threads <= max_threads; threads *= 2) {
+            f64 concurrent = run(threads, ops,
+                [&] { return concurrent_pool.allocate(); },
+                [&](void* block) { concurrent_pool.deallocate(block); });
+            f64 locked = run(threads, ops,
+                [&] { std::lock_guard<std::mutex> guard(pool_lock); return pool.allocate(); },
+                [&](void* block) { std::lock_guard<std::mutex> guard(pool_lock); pool.deallocate(block); });
+            f64 system = run(threads, ops,
+                [] { return std::malloc(BLOCK_SIZE); },
+                [](void* block) { std::free(block); });
+            std::printf("%-8u %16.1f %16.1f %16.1f\n", threads, concurrent, locked, system);
+        }
+    }
+
+    memory::MemorySystem::shutdown();
+    core::logger::Logger::shutdown();
+    return EXIT_SUCCESS;
+}
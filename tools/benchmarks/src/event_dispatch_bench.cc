@@ -0,0 +1,122 @@
+// Measures EventHandler post_event + poll_events throughput. Each frame posts
+// EVENTS_PER_FRAME events spread over WINDOWS windows and EVENT_KINDS event
+// types. Every window has CALLBACKS_PER_WINDOW callbacks per type, and each type
+// has one global callback. One event in PROPAGATE_EVERY also reaches the global
+// callbacks. The same loop with no callbacks registered gives the post + poll
+// overhead, so the difference is the cost of dispatch itself.
+//
+//   event_dispatch_bench [frames]
+#include <core/events/events.h>
+#include <core/logger.h>
+#include <memory/memory.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace gravity;
+using namespace gravity::core;
+
+namespace {
+
+constexpr u32 WINDOWS = 4;
+constexpr u32 EVENT_KINDS = 4;
+constexpr u32 CALLBACKS_PER_WINDOW = 2;
+constexpr u32 EVENTS_PER_FRAME = 256;
+constexpr u32 PROPAGATE_EVERY = 8;
+
+constexpr EventType TYPES[EVENT_KINDS] = {
+    EventType::KEY_PRESSED,
+    EventType::KEY_RELEASED,
+    EventType::MOUSE_MOVE,
+    EventType::WINDOW_RESIZED,
+};
+
+// Windows are only used as keys, so a few aligned blocks stand in for them
+alignas(16) char window_storage[WINDOWS][64];
+
+const platform::Window& window(u32 index) {
+    return *reinterpret_cast<const platform::Window*>(window_storage[index]);
+}
+
+u64 calls = 0;
+
+bool count_call(Event& event, EventContext&) {
+    calls += static_cast<u64>(event.type()) + 1;
+    return true;
+}
+
+/// @brief Event of any type from a given window
+class BenchEvent : public Event {
+public:
+    BenchEvent(EventType type, const platform::Window& window, bool propagate)
+        : Event(type)
+        , _window(&window)
+    {
+        _propagation.propogate = propagate;
+    }
+
+    const platform::Window& source_window() const override { return *_window; }
+
+private:
+    const platform::Window* _window;
+};
+
+/// @brief Post and poll `frames` frames of events
+/// @return Nanoseconds per event
+f64 run(u32 frames) {
+    EventHandler* handler = EventHandler::get();
+    auto start = std::chrono::steady_clock::now();
+    for (u32 frame = 0; frame < frames; frame++) {
+        for (u32 i = 0; i < EVENTS_PER_FRAME; i++) {
+            handler->post_event(BenchEvent(TYPES[i % EVENT_KINDS], window(i % WINDOWS), i % PROPAGATE_EVERY == 0));
+        }
+        handler->poll_events();
+    }
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (static_cast<f64>(frames) * EVENTS_PER_FRAME);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 frames = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 20'000;
+
+    // No Platform is started, so there is no console to log to
+    core::logger::Logger::startup();
+    core::logger::Logger::get()->use_console(false);
+    memory::MemorySystem::startup();
+    EventHandler::startup();
+
+    // Warm up buffers before timing the bare post + poll loop
+    run(frames / 10);
+    f64 overhead = run(frames);
+
+    EventHandler* handler = EventHandler::get();
+    for (u32 w = 0; w < WINDOWS; w++) {
+        for (EventType type : TYPES) {
+            for (u32 k = 0; k < CALLBACKS_PER_WINDOW; k++) {
+                handler->register_callback(&window(w), type, count_call, "bench", static_cast<EventPriority>(k * 2));
+            }
+        }
+    }
+    for (EventType type : TYPES) {
+        handler->register_callback(nullptr, type, count_call, "bench_global");
+    }
+
+    run(frames / 10);
+    calls = 0;
+    f64 total = run(frames);
+
+    std::printf("%u frames of %u events, %u windows x %u types, %u callbacks per window and type + 1 global\n",
+        frames, EVENTS_PER_FRAME, WINDOWS, EVENT_KINDS, CALLBACKS_PER_WINDOW);
+    std::printf("%-24s %10.1f ns/event %10.1f M events/s\n", "post + poll only", overhead, 1e3 / overhead);
+    std::printf("%-24s %10.1f ns/event %10.1f M events/s\n", "post + poll + dispatch", total, 1e3 / total);
+    std::printf("%-24s %10.1f ns/event\n", "dispatch", total - overhead);
+    std::printf("(checksum %llu)\n", static_cast<unsigned long long>(calls));
+
+    EventHandler::shutdown();
+    memory::MemorySystem::shutdown();
+    core::logger::Logger::shutdown();
+    return EXIT_SUCCESS;
+}
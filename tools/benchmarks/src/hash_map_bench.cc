@@ -0,0 +1,128 @@
+// Compares containers::HashMap with std::unordered_map on the key types the
+// engine looks up every frame: window pointers, window names and EventType.
+// Reports lookup hits per map size, and inserts of random u64 keys.
+//
+//   hash_map_bench [lookups]
+#include <containers/hash_map.h>
+#include <core/events/events.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace gravity;
+
+namespace {
+
+constexpr int REPEATS = 5;
+constexpr usize MAP_SIZES[] = { 4, 64, 4096 };
+
+volatile u64 sink;
+
+/// @brief Average time of one of `ops` operations done by `fn`, over REPEATS runs
+template <typename FN>
+f64 ns_per_op(usize ops, FN&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++) {
+        fn();
+    }
+    f64 ns = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (static_cast<f64>(REPEATS) * static_cast<f64>(ops));
+}
+
+/// @brief Time lookups of `queries` in both maps built from `keys`
+template <typename K>
+void bench_lookups(const char* name, const std::vector<K>& keys, const std::vector<usize>& queries) {
+    containers::HashMap<K, u64> map;
+    std::unordered_map<K, u64> std_map;
+    for (usize i = 0; i < keys.size(); i++) {
+        map[keys[i]] = i;
+        std_map[keys[i]] = i;
+    }
+
+    f64 ours = ns_per_op(queries.size(), [&] {
+        u64 sum = 0;
+        for (usize q : queries) {
+            sum += map.find(keys[q])->second;
+        }
+        sink = sum;
+    });
+    f64 theirs = ns_per_op(queries.size(), [&] {
+        u64 sum = 0;
+        for (usize q : queries) {
+            sum += std_map.find(keys[q])->second;
+        }
+        sink = sum;
+    });
+    std::printf("%-10s %6zu %12.2f %16.2f\n", name, keys.size(), ours, theirs);
+}
+
+std::vector<usize> random_queries(std::mt19937_64& rng, usize count, usize key_count) {
+    std::vector<usize> queries(count);
+    for (usize& q : queries) {
+        q = rng() % key_count;
+    }
+    return queries;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    usize lookups = argc > 1 ? static_cast<usize>(std::atoll(argv[1])) : usize(1) << 20;
+    std::mt19937_64 rng(3);
+
+    std::printf("Lookup hits, ns/op over %zu lookups\n", lookups);
+    std::printf("%-10s %6s %12s %16s\n", "KEY", "N", "HASHMAP", "UNORDERED_MAP");
+
+    for (usize size : MAP_SIZES) {
+        // Stand-ins for Window*: distinct heap addresses
+        std::vector<u64> storage(size);
+        std::vector<const void*> keys;
+        for (u64& slot : storage) {
+            keys.push_back(&slot);
+        }
+        bench_lookups("pointer", keys, random_queries(rng, lookups, size));
+    }
+
+    for (usize size : MAP_SIZES) {
+        std::vector<std::string> keys;
+        for (usize i = 0; i < size; i++) {
+            keys.push_back("window_name_" + std::to_string(i));
+        }
+        bench_lookups("string", keys, random_queries(rng, lookups, size));
+    }
+
+    {
+        std::vector<core::EventType> keys;
+        for (u32 i = 0; i < core::EVENT_TYPES; i++) {
+            keys.push_back(static_cast<core::EventType>(i));
+        }
+        bench_lookups("EventType", keys, random_queries(rng, lookups, keys.size()));
+    }
+
+    constexpr usize INSERTS = 100000;
+    std::vector<u64> keys(INSERTS);
+    for (u64& key : keys) {
+        key = rng();
+    }
+    f64 ours = ns_per_op(INSERTS, [&] {
+        containers::HashMap<u64, u64> map;
+        for (usize i = 0; i < INSERTS; i++) {
+            map[keys[i]] = i;
+        }
+        sink = map.size();
+    });
+    f64 theirs = ns_per_op(INSERTS, [&] {
+        std::unordered_map<u64, u64> map;
+        for (usize i = 0; i < INSERTS; i++) {
+            map[keys[i]] = i;
+        }
+        sink = map.size();
+    });
+    std::printf("\nInserting %zu random u64 keys, ns/op: HashMap %.2f, unordered_map %.2f\n", INSERTS, ours, theirs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+// Compares containers::SpscRingQueue and containers::MpmcRingQueue with a
+// mutex-guarded std::queue. Every run checks that all values arrive (and, for
+// SPSC, arrive in order), so a broken queue fails loudly instead of scoring well.
+//
+//   ring_queue_bench [max_threads] [values]
+#include <containers/ring_queue.h>
+#include <core/logger.h>
+#include <memory/memory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace gravity;
+
+namespace {
+
+constexpr usize CAPACITY = 4096;
+constexpr usize BATCH = 32;
+
+[[noreturn]] void fail(const char* what) {
+    std::fprintf(stderr, "ring_queue_bench: %s\n", what);
+    std::abort();
+}
+
+f64 seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief One producer and one consumer (the calling thread) pass `count` values through `queue`
+/// @param batch Values per push/pop call; 1 uses try_push/try_pop
+/// @return Millions of values per second
+f64 run_spsc(containers::SpscRingQueue<u64>& queue, u64 count, usize batch) {
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        u64 values[BATCH];
+        for (u64 i = 0; i < count;) {
+            if (batch == 1) {
+                while (!queue.try_push(i)) {
+                    std::this_thread::yield();
+                }
+                i++;
+                continue;
+            }
+            usize n = static_cast<usize>(std::min<u64>(batch, count - i));
+            for (usize j = 0; j < n; j++) {
+                values[j] = i + j;
+            }
+            for (usize pushed = 0; pushed < n;) {
+                usize done = queue.try_push_batch(values + pushed, n - pushed);
+                if (!done) {
+                    std::this_thread::yield();
+                }
+                pushed += done;
+            }
+            i += n;
+        }
+    });
+
+    u64 values[BATCH];
+    for (u64 received = 0; received < count;) {
+        usize n = batch == 1 ? (queue.try_pop(values[0]) ? 1 : 0) : queue.try_pop_batch(values, batch);
+        if (!n) {
+            std::this_thread::yield();
+        }
+        for (usize j = 0; j < n; j++) {
+            if (values[j] != received + j) {
+                fail("SPSC values arrived out of order");
+            }
+        }
+        received += n;
+    }
+    producer.join();
+    return static_cast<f64>(count) / seconds_since(start) / 1e6;
+}
+
+/// @brief `threads` producers and `threads` consumers pass `count` values through `push`/`pop`
+/// @param pop Adds popped values to its argument and returns how many it popped
+/// @return Millions of values per second
+template <typename PUSH, typename POP>
+f64 run_mpmc(u32 threads, u64 count, PUSH&& push, POP&& pop) {
+    u64 per_thread = count / threads;
+    u64 total = per_thread * threads;
+    std::atomic<u64> received { 0 };
+    std::atomic<u64> sum { 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (u32 t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (u64 i = 0; i < per_thread; i++) {
+                push(t * per_thread + i + 1);
+            }
+        });
+        workers.emplace_back([&] {
+            u64 local = 0;
+            while (received.load(std::memory_order_relaxed) < total) {
+                usize n = pop(local);
+                if (n) {
+                    received.fetch_add(n, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            sum.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (sum.load() != total * (total + 1) / 2) {
+        fail("MPMC values were lost or duplicated");
+    }
+    return static_cast<f64>(total) / seconds_since(start) / 1e6;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 max_threads = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+    u64 count = argc > 2 ? static_cast<u64>(std::atoll(argv[2])) : 2'000'000;
+
+    // No Platform is started, so there is no console to log to
+    core::logger::Logger::startup();
+    core::logger::Logger::get()->use_console(false);
+    memory::MemorySystem::startup();
+
+    {
+        std::printf("%llu u64 values, capacity %zu, batch %zu   (M values/s)\n",
+            static_cast<unsigned long long>(count), CAPACITY, BATCH);
+
+        containers::SpscRingQueue<u64> spsc(CAPACITY);
+        f64 single = run_spsc(spsc, count, 1);
+        f64 batched = run_spsc(spsc, count, BATCH);
+        std::printf("SPSC  %16s %10.1f\n", "single", single);
+        std::printf("SPSC  %16s %10.1f\n", "batch", batched);
+
+        std::printf("%-8s %16s %16s %16s\n", "THREADS", "MPMC", "MPMC POP BATCH", "MUTEX+QUEUE");
+        for (u32 threads = 1; threads <= max_threads; threads *= 2) {
+            containers::MpmcRingQueue<u64> mpmc(CAPACITY);
+            auto push = [&](u64 value) {
+                while (!mpmc.try_push(value)) {
+                    std::this_thread::yield();
+                }
+            };
+
+            f64 ring = run_mpmc(threads, count, push, [&](u64& sum) -> usize {
+                u64 value;
+                if (!mpmc.try_pop(value)) {
+                    return 0;
+                }
+                sum += value;
+                return 1;
+            });
+            f64 ring_batched = run_mpmc(threads, count, push, [&](u64& sum) -> usize {
+                u64 values[BATCH];
+                usize n = mpmc.try_pop_batch(values, BATCH);
+                for (usize i = 0; i < n; i++) {
+                    sum += values[i];
+                }
+                return n;
+            });
+
+            std::mutex lock;
+            std::queue<u64> locked_queue;
+            f64 locked = run_mpmc(threads, count,
+                [&](u64 value) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    locked_queue.push(value);
+                },
+                [&](u64& sum) -> usize {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (locked_queue.empty()) {
+                        return 0;
+                    }
+                    sum += locked_queue.front();
+                    locked_queue.pop();
+                    return 1;
+                });
+
+            std::printf("%-8u %16.1f %16.1f %16.1f\n", threads, ring, ring_batched, locked);
+        }
+    }
+
+    memory::MemorySystem::shutdown();
+    core::logger::Logger::shutdown();
+    return EXIT_SUCCESS;
+}